@@ -0,0 +1,396 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <initializer_list>
+#include <iterator>
+#include <vector>
+#include "flat_search.hpp"
+
+namespace stl
+{
+    ///////////////////////////////////////////////////////////////////////////////
+    /// Template class FlatSet
+    ///////////////////////////////////////////////////////////////////////////////
+
+    // Set kept in a sorted vector, for read-mostly data updated in bulk. Lookups
+    // are a branchless binary search and iteration walks contiguous memory.
+    //
+    // Updates do not touch the main array at once: inserted keys which are absent
+    // from it and erased keys which are present in it are buffered in two small
+    // sorted vectors. Once the buffers grow past max(32, sqrt(n)) keys an update
+    // merges them into the main array in a single O(n + m) pass, flush() does it
+    // on demand. Const members never merge: lookups search the main array and
+    // the buffers, and iterators walk the three of them together, so concurrent
+    // readers are safe. Iterators are invalidated by any update.
+
+    template <typename TKey>
+    class FlatSet
+    {
+        std::vector<TKey> keys_;
+        std::vector<TKey> pending_inserts_;
+        std::vector<TKey> pending_erases_;
+
+     public:
+        typedef TKey value_type;
+        class iterator;
+        typedef std::reverse_iterator<iterator> reverse_iterator;
+
+        static constexpr size_t kMinPending = 32;
+
+        FlatSet() = default;
+
+        template <class _InputIterator>
+        FlatSet(_InputIterator first, _InputIterator last)
+        {
+            insert_batch(first, last);
+        }
+
+        explicit FlatSet(const std::initializer_list<value_type>& l) : FlatSet(l.begin(), l.end()) { }
+
+        void clear()
+        {
+            keys_.clear();
+            pending_inserts_.clear();
+            pending_erases_.clear();
+        }
+
+        void insert(const value_type& val)
+        {
+            if (in_keys(val)) {
+                remove_sorted(pending_erases_, val);
+            } else {
+                add_sorted(pending_inserts_, val);
+                merge_if_full();
+            }
+        }
+
+        void erase(const value_type& val)
+        {
+            if (in_keys(val)) {
+                add_sorted(pending_erases_, val);
+                merge_if_full();
+            } else {
+                remove_sorted(pending_inserts_, val);
+            }
+        }
+
+        // Sorts the batch once and buffers it as a whole, a batch larger than the
+        // buffer limit is merged into the main array right away
+        template <class _InputIterator>
+        void insert_batch(_InputIterator first, _InputIterator last)
+        {
+            std::vector<TKey> batch(first, last), absent;
+            sort_unique(batch);
+            auto present = std::stable_partition(batch.begin(), batch.end(),
+                                                 [&](const value_type& val) { return !in_keys(val); });
+            absent.reserve(pending_inserts_.size() + (present - batch.begin()));
+            std::set_union(pending_inserts_.begin(), pending_inserts_.end(), batch.begin(), present,
+                           std::back_inserter(absent));
+            pending_inserts_.swap(absent);
+            subtract_sorted(pending_erases_, present, batch.end());
+            merge_if_full();
+        }
+
+        template <class _InputIterator>
+        void erase_batch(_InputIterator first, _InputIterator last)
+        {
+            std::vector<TKey> batch(first, last), present;
+            sort_unique(batch);
+            auto absent = std::stable_partition(batch.begin(), batch.end(),
+                                                [&](const value_type& val) { return in_keys(val); });
+            present.reserve(pending_erases_.size() + (absent - batch.begin()));
+            std::set_union(pending_erases_.begin(), pending_erases_.end(), batch.begin(), absent,
+                           std::back_inserter(present));
+            pending_erases_.swap(present);
+            subtract_sorted(pending_inserts_, absent, batch.end());
+            merge_if_full();
+        }
+
+        // Applies buffered updates to the main array in O(n + m)
+        void flush()
+        {
+            if (pending_inserts_.empty() && pending_erases_.empty()) {
+                return;
+            }
+            std::vector<TKey> kept, merged;
+            kept.reserve(keys_.size() - pending_erases_.size());
+            std::set_difference(keys_.begin(), keys_.end(), pending_erases_.begin(), pending_erases_.end(),
+                                std::back_inserter(kept));
+            merged.reserve(kept.size() + pending_inserts_.size());
+            std::merge(kept.begin(), kept.end(), pending_inserts_.begin(), pending_inserts_.end(),
+                       std::back_inserter(merged));
+            keys_.swap(merged);
+            pending_inserts_.clear();
+            pending_erases_.clear();
+        }
+
+        // Number of buffered updates
+        size_t pending() const
+        {
+            return pending_inserts_.size() + pending_erases_.size();
+        }
+
+        bool contains(const value_type& val) const
+        {
+            if (in_keys(val)) {
+                return !in_sorted(pending_erases_, val);
+            }
+            return in_sorted(pending_inserts_, val);
+        }
+
+        iterator find(const value_type& val) const
+        {
+            auto it = lower_bound(val);
+            return (it != end() && !(val < *it)) ? it : end();
+        }
+
+        iterator lower_bound(const value_type& val) const
+        {
+            return position(branchless_lower_bound(keys_.data(), keys_.size(), val) - keys_.data(),
+                            branchless_lower_bound(pending_inserts_.data(), pending_inserts_.size(), val) -
+                            pending_inserts_.data());
+        }
+
+        iterator upper_bound(const value_type& val) const
+        {
+            return position(branchless_upper_bound(keys_.data(), keys_.size(), val) - keys_.data(),
+                            branchless_upper_bound(pending_inserts_.data(), pending_inserts_.size(), val) -
+                            pending_inserts_.data());
+        }
+
+        iterator begin() const
+        {
+            return position(0, 0);
+        }
+
+        iterator end() const
+        {
+            return iterator(this, keys_.size(), pending_inserts_.size(), pending_erases_.size());
+        }
+
+        reverse_iterator rbegin() const
+        {
+            return reverse_iterator(end());
+        }
+
+        reverse_iterator rend() const
+        {
+            return reverse_iterator(begin());
+        }
+
+        size_t size() const
+        {
+            return keys_.size() + pending_inserts_.size() - pending_erases_.size();
+        }
+
+        bool empty() const
+        {
+            return size() == 0;
+        }
+
+     private:
+        // Iterator to the first key at or after keys_[key] which is not erased and
+        // pending_inserts_[insert]
+        iterator position(size_t key, size_t insert) const
+        {
+            size_t erased(pending_erases_.size());
+            if (key < keys_.size()) {
+                erased = std::lower_bound(pending_erases_.begin(), pending_erases_.end(), keys_[key]) -
+                         pending_erases_.begin();
+            }
+            iterator it(this, key, insert, erased);
+            it.skip_erased();
+            return it;
+        }
+
+        bool in_keys(const value_type& val) const
+        {
+            return in_sorted(keys_, val);
+        }
+
+        static bool in_sorted(const std::vector<TKey>& keys, const value_type& val)
+        {
+            auto it = branchless_lower_bound(keys.data(), keys.size(), val);
+            return it != keys.data() + keys.size() && !(val < *it);
+        }
+
+        static void add_sorted(std::vector<TKey>& keys, const value_type& val)
+        {
+            auto it = std::lower_bound(keys.begin(), keys.end(), val);
+            if (it == keys.end() || val < *it) {
+                keys.insert(it, val);
+            }
+        }
+
+        static void remove_sorted(std::vector<TKey>& keys, const value_type& val)
+        {
+            auto it = std::lower_bound(keys.begin(), keys.end(), val);
+            if (it != keys.end() && !(val < *it)) {
+                keys.erase(it);
+            }
+        }
+
+        template <class _Iterator>
+        static void subtract_sorted(std::vector<TKey>& keys, _Iterator first, _Iterator last)
+        {
+            std::vector<TKey> rest;
+            rest.reserve(keys.size());
+            std::set_difference(keys.begin(), keys.end(), first, last, std::back_inserter(rest));
+            keys.swap(rest);
+        }
+
+        static void sort_unique(std::vector<TKey>& keys)
+        {
+            std::sort(keys.begin(), keys.end());
+            keys.erase(std::unique(keys.begin(), keys.end(),
+                                   [](const value_type& a, const value_type& b) { return !(a < b); }),
+                       keys.end());
+        }
+
+        // Buffer operations cost O(m), merging O(n + m): a buffer of sqrt(n)
+        // keys keeps both at O(sqrt(n)) per update
+        void merge_if_full()
+        {
+            if (pending() > std::max<size_t>(kMinPending, std::sqrt(double(keys_.size())))) {
+                flush();
+            }
+        }
+    };
+
+
+    ///////////////////////////////////////////////////////////////////////////////
+    /// Class FlatSet::iterator
+    ///////////////////////////////////////////////////////////////////////////////
+
+    // Position in the main array, in the inserts buffer and in the erases buffer.
+    // The current key is the lesser of the two candidates, the keys of the main
+    // array found in the erases buffer are stepped over. With no pending updates
+    // it only walks the main array.
+
+    template <typename TKey>
+    class FlatSet<TKey>::iterator
+    {
+        friend class FlatSet;
+
+        const FlatSet* set_;
+        size_t key_;
+        size_t insert_;
+        size_t erase_;
+
+        iterator(const FlatSet* set, size_t key, size_t insert, size_t erase)
+            : set_(set), key_(key), insert_(insert), erase_(erase) { }
+
+        const std::vector<TKey>& keys() const
+        {
+            return set_->keys_;
+        }
+
+        const std::vector<TKey>& inserts() const
+        {
+            return set_->pending_inserts_;
+        }
+
+        const std::vector<TKey>& erases() const
+        {
+            return set_->pending_erases_;
+        }
+
+        bool at_key() const
+        {
+            return key_ < keys().size() && (insert_ == inserts().size() || keys()[key_] < inserts()[insert_]);
+        }
+
+        // Moves key_ forward past the erased keys, erase_ stays the lower bound of keys()[key_]
+        void skip_erased()
+        {
+            for (; key_ < keys().size(); key_++) {
+                while (erase_ < erases().size() && erases()[erase_] < keys()[key_]) {
+                    erase_++;
+                }
+                if (erase_ == erases().size() || keys()[key_] < erases()[erase_]) {
+                    return;
+                }
+            }
+            erase_ = erases().size();
+        }
+
+     public:
+        typedef std::bidirectional_iterator_tag iterator_category;
+        typedef std::ptrdiff_t difference_type;
+        typedef TKey value_type;
+        typedef const TKey* pointer;
+        typedef const TKey& reference;
+
+        iterator() : set_(nullptr), key_(0), insert_(0), erase_(0) { }
+
+        reference operator*() const
+        {
+            return at_key() ? keys()[key_] : inserts()[insert_];
+        }
+
+        pointer operator->() const
+        {
+            return &**this;
+        }
+
+        iterator& operator++()
+        {
+            if (at_key()) {
+                key_++;
+                skip_erased();
+            } else {
+                insert_++;
+            }
+            return *this;
+        }
+
+        iterator operator++(int)
+        {
+            iterator tmp(*this);
+            ++*this;
+            return tmp;
+        }
+
+        // Steps to the greater of the previous key of the main array which is not
+        // erased and the previous pending insert
+        iterator& operator--()
+        {
+            size_t key(key_), erase(erase_);
+            bool found(false);
+            while (key > 0) {
+                key--;
+                while (erase > 0 && !(erases()[erase - 1] < keys()[key])) {
+                    erase--;
+                }
+                if (erase == erases().size() || keys()[key] < erases()[erase]) {
+                    found = true;
+                    break;
+                }
+            }
+            if (found && (insert_ == 0 || inserts()[insert_ - 1] < keys()[key])) {
+                key_ = key, erase_ = erase;
+            } else {
+                insert_--;
+            }
+            return *this;
+        }
+
+        iterator operator--(int)
+        {
+            iterator tmp(*this);
+            --*this;
+            return tmp;
+        }
+
+        friend bool operator==(const iterator& left, const iterator& right)
+        {
+            return left.key_ == right.key_ && left.insert_ == right.insert_;
+        }
+
+        friend bool operator!=(const iterator& left, const iterator& right)
+        {
+            return !(left == right);
+        }
+    };
+}
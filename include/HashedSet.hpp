@@ -0,0 +1,180 @@
+#pragma once
+
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include "hash_index.hpp"
+#include "redblacktree.hpp"
+
+namespace stl
+{
+    ///////////////////////////////////////////////////////////////////////////////
+    /// Template class HashedSet
+    ///////////////////////////////////////////////////////////////////////////////
+
+    // Set which keeps a HashIndex of its nodes next to the tree: find() and
+    // contains() are answered by the hash index in O(1) on average, ordered
+    // operations and iteration use the tree. insert() and erase() update both
+    // in the same call, and an insert of a present key is rejected by the
+    // index without descending the tree.
+    //
+    // On top of the tree nodes the index takes 10.3 to 20.6 bytes per key while
+    // keys are only inserted, about 15 on average, and up to 36 once keys are
+    // erased, see HashIndex. A std::unordered_set kept next to a Set
+    // costs a heap node per key instead, 32 bytes for an int with glibc malloc,
+    // plus 8 bytes per bucket.
+
+    template <typename TKey, typename TTraits = TreeTraits<TKey>, typename THash = std::hash<TKey>>
+    class HashedSet
+    {
+        static_assert(TTraits::unique_keys, "HashedSet indexes one node per key");
+
+        typedef RedBlackTree<TKey, TTraits> tree_type;
+        typedef typename tree_type::_Base_ptr _Base_ptr;
+
+        tree_type rb_tree_;
+        HashIndex<TKey, _Base_ptr, THash> index_;
+
+     public:
+        typedef TKey value_type;
+        typedef typename tree_type::iterator iterator;
+        typedef typename tree_type::reverse_iterator reverse_iterator;
+
+        HashedSet() = default;
+
+        template <class _InputIterator>
+        HashedSet(_InputIterator first, _InputIterator last)
+        {
+            for (; first != last; ++first) {
+                insert(*first);
+            }
+        }
+
+        explicit HashedSet(const std::initializer_list<value_type>& l) : HashedSet(l.begin(), l.end()) { }
+
+        HashedSet(const HashedSet& other) : rb_tree_(other.rb_tree_)
+        {
+            reindex();
+        }
+
+        HashedSet& operator=(const HashedSet& other)
+        {
+            if (&other != this) {
+                rb_tree_ = other.rb_tree_;
+                reindex();
+            }
+            return *this;
+        }
+
+        void clear()
+        {
+            rb_tree_.clear();
+            index_.clear();
+        }
+
+        void insert(const value_type& val)
+        {
+            if (!index_.find(val)) {
+                index_.insert(val, rb_tree_.try_emplace(val, val).first);
+            }
+        }
+
+        void erase(const value_type& val)
+        {
+            if (auto node = index_.find(val)) {
+                erase(iterator(node));
+            }
+        }
+
+        iterator erase(iterator pos)
+        {
+            index_.erase(*pos);
+            if constexpr (copy_keys_on_erase_v<TKey, TTraits>) {
+                auto next = std::next(pos);
+                if (next != end()) {
+                    // the node of pos may take the next key, whose node is freed
+                    value_type next_key = *next;
+                    auto result = rb_tree_.erase(pos);
+                    if (result.node == pos.node) {
+                        index_.replace(next_key, next.node, pos.node);
+                    }
+                    return result;
+                }
+            }
+            return rb_tree_.erase(pos);
+        }
+
+        iterator find(const value_type& val) const
+        {
+            auto node = index_.find(val);
+            return node ? iterator(node) : end();
+        }
+
+        bool contains(const value_type& val) const
+        {
+            return index_.find(val) != nullptr;
+        }
+
+        iterator lower_bound(const value_type& val) const
+        {
+            return rb_tree_.lower_bound(val);
+        }
+
+        iterator upper_bound(const value_type& val) const
+        {
+            return rb_tree_.upper_bound(val);
+        }
+
+        RangeView<iterator> range(const value_type& lo,
+                                  const value_type& hi,
+                                  Bounds bounds = Bounds::Closed) const
+        {
+            return rb_tree_.range(lo, hi, bounds);
+        }
+
+        iterator begin() const
+        {
+            return rb_tree_.begin();
+        }
+
+        iterator end() const
+        {
+            return rb_tree_.end();
+        }
+
+        reverse_iterator rbegin() const
+        {
+            return rb_tree_.rbegin();
+        }
+
+        reverse_iterator rend() const
+        {
+            return rb_tree_.rend();
+        }
+
+        size_t size() const
+        {
+            return rb_tree_.size();
+        }
+
+        bool empty() const
+        {
+            return rb_tree_.empty();
+        }
+
+        // Bytes taken by the hash index, the tree nodes are not counted
+        size_t index_memory_usage() const
+        {
+            return index_.memory_usage();
+        }
+
+     private:
+        void reindex()
+        {
+            index_.clear();
+            for (auto it = begin(); it != end(); ++it) {
+                index_.insert(*it, it.node);
+            }
+        }
+    };
+}
@@ -0,0 +1,202 @@
+#pragma once
+
+#include <initializer_list>
+#include "redblacktree.hpp"
+
+namespace stl
+{
+    // Half-open interval [start, end)
+    template <typename T>
+    struct Interval
+    {
+        T start, end;
+
+        bool overlaps(const Interval& other) const
+        {
+            return start < other.end && other.start < end;
+        }
+
+        bool contains(const T& point) const
+        {
+            return !(point < start) && point < end;
+        }
+
+        friend bool operator<(const Interval& left, const Interval& right)
+        {
+            return left.start < right.start || (!(right.start < left.start) && left.end < right.end);
+        }
+
+        friend bool operator==(const Interval& left, const Interval& right)
+        {
+            return !(left < right) && !(right < left);
+        }
+    };
+
+    // Element of IntervalSet: an interval and the largest end in its subtree
+    template <typename T>
+    struct IntervalEntry : Interval<T>
+    {
+        T max_end;
+
+        IntervalEntry() : Interval<T>(), max_end() { }
+        explicit IntervalEntry(const Interval<T>& interval) : Interval<T>(interval), max_end(interval.end) { }
+    };
+
+    template <typename T>
+    struct IntervalTraits : TreeTraits<IntervalEntry<T>>
+    {
+        typedef Interval<T> key_type;
+
+        static const key_type& key_of(const IntervalEntry<T>& entry)
+        {
+            return entry;
+        }
+
+        static constexpr bool augmented = true;
+
+        static void update(IntervalEntry<T>& entry,
+                           const IntervalEntry<T>* left,
+                           const IntervalEntry<T>* right)
+        {
+            entry.max_end = entry.end;
+            if (left && entry.max_end < left->max_end) {
+                entry.max_end = left->max_end;
+            }
+            if (right && entry.max_end < right->max_end) {
+                entry.max_end = right->max_end;
+            }
+        }
+    };
+
+    ///////////////////////////////////////////////////////////////////////////////
+    /// Template class IntervalSet
+    ///////////////////////////////////////////////////////////////////////////////
+
+    // Set of half-open intervals ordered by (start, end). Every node keeps the
+    // largest end of its subtree, so a subtree is skipped when all of its
+    // intervals end too early or start too late. Reporting the k intervals
+    // overlapping a range or containing a point costs O(min(n, (k + 1) log n)):
+    // every visited subtree holds a match, but intervals ending early may sit on
+    // the path to each of them, so it is not the O(log n + k) of a centered
+    // interval tree.
+
+    template <typename T, typename TTraits = IntervalTraits<T>>
+    class IntervalSet
+    {
+        static_assert(TTraits::augmented, "IntervalSet requires the max end summary");
+
+        typedef RedBlackTree<IntervalEntry<T>, TTraits> tree_type;
+        typedef typename tree_type::_Base_ptr _Base_ptr;
+
+        tree_type rb_tree_;
+
+     public:
+        typedef Interval<T> value_type;
+        typedef typename tree_type::iterator iterator;
+
+        IntervalSet() = default;
+
+        explicit IntervalSet(const std::initializer_list<value_type>& l)
+        {
+            for (auto& interval: l) {
+                insert(interval);
+            }
+        }
+
+        void clear()
+        {
+            rb_tree_.clear();
+        }
+
+        void insert(const value_type& interval)
+        {
+            rb_tree_.insert(IntervalEntry<T>(interval));
+        }
+
+        void erase(const value_type& interval)
+        {
+            rb_tree_.erase(interval);
+        }
+
+        iterator erase(iterator pos)
+        {
+            return rb_tree_.erase(pos);
+        }
+
+        iterator find(const value_type& interval) const
+        {
+            return rb_tree_.find(interval);
+        }
+
+        bool contains(const value_type& interval) const
+        {
+            return rb_tree_.contains(interval).second;
+        }
+
+        // Calls fn for every interval overlapping [lo, hi) in ascending order
+        template <typename TFunc>
+        void for_each_overlap(const T& lo, const T& hi, TFunc fn) const
+        {
+            visit(rb_tree_.root(), lo, [&](const T& start) { return start < hi; }, fn);
+        }
+
+        // Calls fn for every interval containing point in ascending order
+        template <typename TFunc>
+        void for_each_stabbing(const T& point, TFunc fn) const
+        {
+            visit(rb_tree_.root(), point, [&](const T& start) { return !(point < start); }, fn);
+        }
+
+        template <class _OutputIterator>
+        _OutputIterator overlapping(const T& lo, const T& hi, _OutputIterator out) const
+        {
+            for_each_overlap(lo, hi, [&](const value_type& interval) { *out++ = interval; });
+            return out;
+        }
+
+        template <class _OutputIterator>
+        _OutputIterator stabbing(const T& point, _OutputIterator out) const
+        {
+            for_each_stabbing(point, [&](const value_type& interval) { *out++ = interval; });
+            return out;
+        }
+
+        iterator begin() const
+        {
+            return rb_tree_.begin();
+        }
+
+        iterator end() const
+        {
+            return rb_tree_.end();
+        }
+
+        size_t size() const
+        {
+            return rb_tree_.size();
+        }
+
+        bool empty() const
+        {
+            return rb_tree_.empty();
+        }
+
+     private:
+        // In-order walk over intervals ending after lo and starting early enough,
+        // pruned by max_end on the left and by the start order on the right
+        template <typename TStartsBefore, typename TFunc>
+        static void visit(_Base_ptr node, const T& lo, const TStartsBefore& starts_before, TFunc& fn)
+        {
+            while (node && lo < node->key.max_end) {
+                visit(node->child[Left], lo, starts_before, fn);
+                if (!starts_before(node->key.start)) {
+                    return;
+                }
+                if (lo < node->key.end) {
+                    fn(static_cast<const value_type&>(node->key));
+                }
+                node = node->child[Right];
+            }
+        }
+    };
+}
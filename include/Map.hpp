@@ -0,0 +1,180 @@
+#pragma once
+
+#include <initializer_list>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include "redblacktree.hpp"
+
+namespace stl
+{
+    ///////////////////////////////////////////////////////////////////////////////
+    /// Template class Map
+    ///////////////////////////////////////////////////////////////////////////////
+
+    // Ordered key/value container on the same red-black tree as Set. Elements are
+    // std::pair<const TKey, TValue> ordered by the key only, MapTraits tells the
+    // tree how to get the key out of an element. Mapped values can be changed in
+    // place through iterator, keys never.
+    //
+    // The tree header holds a default constructed element, so both TKey and TValue
+    // must be default constructible.
+
+    template <typename TKey, typename TValue, typename TTraits = MapTraits<TKey, TValue>>
+    class Map
+    {
+     public:
+        typedef TKey key_type;
+        typedef TValue mapped_type;
+        typedef std::pair<const TKey, TValue> value_type;
+
+     private:
+        typedef RedBlackTree<value_type, TTraits> tree_type;
+
+        tree_type rb_tree_;
+
+     public:
+        typedef RedBlackTree_iterator<value_type> iterator;
+        typedef typename tree_type::iterator const_iterator;
+
+        Map() = default;
+
+        template <class _InputIterator>
+        Map(_InputIterator first, _InputIterator last) : rb_tree_(first, last) { }
+
+        Map(const std::initializer_list<value_type>& l) : rb_tree_(l) { }
+
+        Map(const Map& other) = default;
+
+        ~Map() { }
+
+        Map& operator=(const Map& other) = default;
+
+        void clear()
+        {
+            rb_tree_.clear();
+        }
+
+        // Inserts a default constructed value if key is absent
+        mapped_type& operator[](const key_type& key)
+        {
+            return try_emplace(key).first->second;
+        }
+
+        mapped_type& at(const key_type& key)
+        {
+            return const_cast<mapped_type&>(std::as_const(*this).at(key));
+        }
+
+        const mapped_type& at(const key_type& key) const
+        {
+            auto it = rb_tree_.find(key);
+            if (it == rb_tree_.end()) {
+                throw std::out_of_range("stl::Map::at: key not found");
+            }
+            return it->second;
+        }
+
+        // Does nothing if key is present, otherwise builds the value from args
+        // without creating a temporary pair
+        template <typename... Args>
+        std::pair<iterator, bool> try_emplace(const key_type& key, Args&&... args)
+        {
+            auto [node, inserted] = rb_tree_.try_emplace(key,
+                                                         std::piecewise_construct,
+                                                         std::forward_as_tuple(key),
+                                                         std::forward_as_tuple(std::forward<Args>(args)...));
+            return {iterator(node), inserted};
+        }
+
+        template <typename TArg>
+        std::pair<iterator, bool> insert_or_assign(const key_type& key, TArg&& value)
+        {
+            auto result = try_emplace(key, std::forward<TArg>(value));
+            if (!result.second) {
+                result.first->second = std::forward<TArg>(value);
+            }
+            return result;
+        }
+
+        std::pair<iterator, bool> insert(const value_type& val)
+        {
+            return try_emplace(val.first, val.second);
+        }
+
+        iterator erase(const_iterator pos)
+        {
+            return iterator(rb_tree_.erase(pos));
+        }
+
+        void erase(const key_type& key)
+        {
+            rb_tree_.erase(key);
+        }
+
+        iterator begin()
+        {
+            return iterator(rb_tree_.begin());
+        }
+
+        iterator end()
+        {
+            return iterator(rb_tree_.end());
+        }
+
+        const_iterator begin() const
+        {
+            return rb_tree_.begin();
+        }
+
+        const_iterator end() const
+        {
+            return rb_tree_.end();
+        }
+
+        iterator find(const key_type& key)
+        {
+            return iterator(rb_tree_.find(key));
+        }
+
+        const_iterator find(const key_type& key) const
+        {
+            return rb_tree_.find(key);
+        }
+
+        bool contains(const key_type& key) const
+        {
+            return rb_tree_.contains(key).second;
+        }
+
+        iterator lower_bound(const key_type& key)
+        {
+            return iterator(rb_tree_.lower_bound(key));
+        }
+
+        const_iterator lower_bound(const key_type& key) const
+        {
+            return rb_tree_.lower_bound(key);
+        }
+
+        iterator upper_bound(const key_type& key)
+        {
+            return iterator(rb_tree_.upper_bound(key));
+        }
+
+        const_iterator upper_bound(const key_type& key) const
+        {
+            return rb_tree_.upper_bound(key);
+        }
+
+        size_t size() const
+        {
+            return rb_tree_.size();
+        }
+
+        bool empty() const
+        {
+            return rb_tree_.empty();
+        }
+    };
+}
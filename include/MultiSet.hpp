@@ -0,0 +1,140 @@
+#pragma once
+
+#include <initializer_list>
+#include <utility>
+#include "redblacktree.hpp"
+
+namespace stl
+{
+    ///////////////////////////////////////////////////////////////////////////////
+    /// Template class MultiSet
+    ///////////////////////////////////////////////////////////////////////////////
+
+    // Ordered container of keys which may repeat, on the same tree as Set.
+    // Equal keys are iterated in the order they were inserted.
+
+    template <typename TKey, typename TTraits = MultiSetTraits<TKey>>
+    class MultiSet
+    {
+        static_assert(!TTraits::unique_keys, "MultiSet traits must allow equal keys");
+
+        RedBlackTree<TKey, TTraits> rb_tree_;
+
+     public:
+        typedef TKey value_type;
+        typedef typename RedBlackTree<value_type, TTraits>::iterator iterator;
+        typedef typename RedBlackTree<value_type, TTraits>::reverse_iterator reverse_iterator;
+
+        MultiSet() = default;
+
+        template <class _InputIterator>
+        MultiSet(_InputIterator first, _InputIterator last) : rb_tree_(first, last) { }
+
+        explicit MultiSet(const std::initializer_list<value_type>& l) : rb_tree_(l) { }
+
+        MultiSet(const MultiSet& other) = default;
+
+        ~MultiSet() { }
+
+        MultiSet& operator=(const MultiSet& other) = default;
+
+        void clear()
+        {
+            rb_tree_.clear();
+        }
+
+        // Inserts val after all keys equal to it
+        void insert(const value_type& val)
+        {
+            rb_tree_.insert(val);
+        }
+
+        iterator erase(iterator pos)
+        {
+            return rb_tree_.erase(pos);
+        }
+
+        iterator erase(iterator first, iterator last)
+        {
+            return rb_tree_.erase(first, last);
+        }
+
+        // Erases all keys equal to val after a single descent, returns their number
+        size_t erase(const value_type& val)
+        {
+            auto count = size();
+            rb_tree_.erase(val);
+            return count - size();
+        }
+
+        // First of the keys equal to val
+        iterator find(const value_type& val) const
+        {
+            auto it = rb_tree_.lower_bound(val);
+            return (it != end() && !(val < *it)) ? it : end();
+        }
+
+        bool contains(const value_type& val) const
+        {
+            return rb_tree_.contains(val).second;
+        }
+
+        // O(log n + k) for k keys equal to val
+        size_t count(const value_type& val) const
+        {
+            return rb_tree_.count(val);
+        }
+
+        std::pair<iterator, iterator> equal_range(const value_type& val) const
+        {
+            return rb_tree_.equal_range(val);
+        }
+
+        iterator lower_bound(const value_type& val) const
+        {
+            return rb_tree_.lower_bound(val);
+        }
+
+        iterator upper_bound(const value_type& val) const
+        {
+            return rb_tree_.upper_bound(val);
+        }
+
+        RangeView<iterator> range(const value_type& lo,
+                                  const value_type& hi,
+                                  Bounds bounds = Bounds::Closed) const
+        {
+            return rb_tree_.range(lo, hi, bounds);
+        }
+
+        iterator begin() const
+        {
+            return rb_tree_.begin();
+        }
+
+        iterator end() const
+        {
+            return rb_tree_.end();
+        }
+
+        reverse_iterator rbegin() const
+        {
+            return rb_tree_.rbegin();
+        }
+
+        reverse_iterator rend() const
+        {
+            return rb_tree_.rend();
+        }
+
+        size_t size() const
+        {
+            return rb_tree_.size();
+        }
+
+        bool empty() const
+        {
+            return rb_tree_.empty();
+        }
+    };
+}
@@ -1,19 +1,47 @@
 #pragma once
 
 #include <initializer_list>
+#include <memory>
+#include <optional>
+#include <utility>
+#include "bloom_filter.hpp"
+#include "lookup_cache.hpp"
 #include "redblacktree.hpp"
+#include "relaxed_counter.hpp"
 
 namespace stl
 {
-    template <typename TKey>
+    template <typename TKey, typename TTraits = TreeTraits<TKey>>
     class Set
     {
-        RedBlackTree<TKey> rb_tree_;
+        RedBlackTree<TKey, TTraits> rb_tree_;
+
+        // optional membership filter consulted by find() before the tree descent,
+        // rebuilt by the updates only: const lookups just read it
+        std::optional<BlockedBloomFilter<TKey>> filter_;
+        size_t filter_stale_keys_ = 0;
+
+        struct FilterCounters
+        {
+            RelaxedCounter lookups;
+            RelaxedCounter rejected;
+            RelaxedCounter false_positives;
+        };
+        mutable FilterCounters filter_counters_;
+
+        // optional cache of the nodes of hot keys consulted by find() before the
+        // descent, filled by find_cached() only
+        typedef LookupCache<TKey, typename RedBlackTree<TKey, TTraits>::_Base_ptr> cache_type;
+        std::unique_ptr<cache_type> cache_;
 
      public:
         typedef TKey value_type;
-        typedef typename RedBlackTree<value_type>::iterator iterator;
-        typedef typename RedBlackTree<value_type>::reverse_iterator reverse_iterator;
+        typedef typename RedBlackTree<value_type, TTraits>::iterator iterator;
+        typedef typename RedBlackTree<value_type, TTraits>::reverse_iterator reverse_iterator;
+        typedef typename RedBlackTree<value_type, TTraits>::node_handle node_type;
+        typedef typename RedBlackTree<value_type, TTraits>::insert_return_type insert_return_type;
+
+        class Cursor;
 
         Set() = default;
 
@@ -22,25 +50,168 @@ namespace stl
 
         explicit Set(const std::initializer_list<value_type>& l) : rb_tree_(l) { }
 
-        Set(const Set& other) = default;
+        // The cache of other points to its nodes: a copy starts with an empty cache
+        // of the same capacity
+        Set(const Set& other)
+            : rb_tree_(other.rb_tree_)
+            , filter_(other.filter_)
+            , filter_stale_keys_(other.filter_stale_keys_)
+            , filter_counters_(other.filter_counters_)
+            , cache_(other.cache_ ? std::make_unique<cache_type>(*other.cache_) : nullptr) { }
 
         ~Set() { }
 
-        Set<value_type>& operator=(const Set<value_type>& other) = default;
+        Set& operator=(const Set& other)
+        {
+            if (&other != this) {
+                rb_tree_ = other.rb_tree_;
+                filter_ = other.filter_;
+                filter_stale_keys_ = other.filter_stale_keys_;
+                filter_counters_ = other.filter_counters_;
+                cache_ = other.cache_ ? std::make_unique<cache_type>(*other.cache_) : nullptr;
+            }
+            return *this;
+        }
 
         void clear()
         {
             rb_tree_.clear();
+            if (filter_) {
+                filter_->reset(0);
+                filter_stale_keys_ = 0;
+            }
+            if (cache_) {
+                cache_->clear();
+            }
         }
 
         void insert(const value_type& val)
         {
             rb_tree_.insert(val);
+            filter_add(val);
+        }
+
+        // Inserts val starting the search from hint, see Cursor
+        iterator insert(iterator hint, const value_type& val)
+        {
+            auto it = rb_tree_.insert(hint, val);
+            filter_add(val);
+            return it;
+        }
+
+        iterator erase(iterator pos)
+        {
+            uncache(pos);
+            auto next = rb_tree_.erase(pos);
+            filter_erased(1);
+            return next;
         }
 
         void erase(const value_type& val)
         {
+            uncache(val);
+            auto count = size();
             rb_tree_.erase(val);
+            filter_erased(count - size());
+        }
+
+        // Unlinks the node of pos and hands it over without freeing it
+        node_type extract(iterator pos)
+        {
+            uncache(pos);
+            auto node = rb_tree_.extract(pos);
+            filter_erased(1);
+            return node;
+        }
+
+        node_type extract(const value_type& val)
+        {
+            auto it = rb_tree_.find(val);
+            return it != end() ? extract(it) : node_type();
+        }
+
+        // Links an extracted node, if its key is present the node stays in the result
+        insert_return_type insert(node_type&& node)
+        {
+            auto result = rb_tree_.insert(std::move(node));
+            if (result.inserted) {
+                filter_add(*result.position);
+            }
+            return result;
+        }
+
+        // Moves the keys of other which are absent here by relinking their nodes
+        void merge(Set& other)
+        {
+            auto count = size();
+            rb_tree_.merge(other.rb_tree_);
+            other.filter_erased(size() - count);
+            if (other.cache_ && count != size()) {
+                other.cache_->clear();
+            }
+            if constexpr (is_hashable_v<value_type>) {
+                if (filter_ && count != size()) {
+                    rebuild_filter();
+                }
+            }
+        }
+
+        // Puts a blocked Bloom filter in front of find(): lookups of absent keys are
+        // mostly answered without descending the tree. The filter takes about
+        // bits_per_key bits per key, 10 bits give ~1% of false positives.
+        void enable_filter(double bits_per_key = 10)
+        {
+            static_assert(is_hashable_v<value_type>, "filter requires std::hash of the key");
+            filter_.emplace(bits_per_key);
+            filter_counters_ = FilterCounters();
+            rebuild_filter();
+        }
+
+        void disable_filter()
+        {
+            filter_.reset();
+        }
+
+        FilterStats filter_stats() const
+        {
+            FilterStats stats;
+            stats.lookups = filter_counters_.lookups;
+            stats.rejected = filter_counters_.rejected;
+            stats.false_positives = filter_counters_.false_positives;
+            if (filter_) {
+                stats.memory_bytes = filter_->memory_usage();
+                stats.bits_per_key = filter_->bits_per_key();
+                stats.expected_false_positive_rate = filter_->expected_false_positive_rate();
+            }
+            return stats;
+        }
+
+        // Puts a cache of the nodes of recently found keys in front of find(): a
+        // lookup of a hot key is answered by a single probe of a cache line and a
+        // key comparison instead of a descent. The cache takes 16 bytes per entry.
+        // Keys enter the cache through find_cached(). Erasing a key drops its
+        // entry, inserts leave cached nodes in place.
+        void enable_cache(size_t capacity = 1024)
+        {
+            static_assert(is_hashable_v<value_type>, "cache requires std::hash of the key");
+            cache_ = std::make_unique<cache_type>(capacity);
+        }
+
+        void disable_cache()
+        {
+            cache_.reset();
+        }
+
+        CacheStats cache_stats() const
+        {
+            return cache_ ? cache_->stats() : CacheStats();
+        }
+
+        // Regions of the node storage selected by TTraits::node_storage, e.g.
+        // stl::Set<int, stl::HugePageTreeTraits<int>> puts its nodes on huge pages
+        NodeStorageStats node_storage_stats() const
+        {
+            return rb_tree_.node_storage_stats();
         }
 
         iterator begin() const
@@ -63,11 +234,60 @@ namespace stl
             return rb_tree_.rend();
         }
 
+        // Reads the filter and the cache but changes neither, so const lookups may
+        // run in several threads at once
         iterator find(const value_type& val) const
         {
+            if constexpr (is_hashable_v<value_type>) {
+                if (filter_ || cache_) {
+                    if (filter_ && !filter_may_contain(val)) {
+                        return end();
+                    }
+                    if (cache_) {
+                        if (auto node = cache_->find(val)) {
+                            return iterator(node);
+                        }
+                    }
+                    auto it = rb_tree_.find(val);
+                    if (it == end()) {
+                        filter_counters_.false_positives += bool(filter_);
+                    }
+                    return it;
+                }
+            }
             return rb_tree_.find(val);
         }
 
+        // find() which also maintains the cache: a found key is cached and a cached
+        // key moves towards the front of its bucket. Changes the set like an update,
+        // must not run concurrently with any other call.
+        iterator find_cached(const value_type& val)
+        {
+            if constexpr (is_hashable_v<value_type>) {
+                if (cache_) {
+                    if (filter_ && !filter_may_contain(val)) {
+                        return end();
+                    }
+                    if (auto node = cache_->promote(val)) {
+                        return iterator(node);
+                    }
+                    auto it = rb_tree_.find(val);
+                    if (it == end()) {
+                        filter_counters_.false_positives += bool(filter_);
+                    } else {
+                        cache_->add(val, it.node);
+                    }
+                    return it;
+                }
+            }
+            return find(val);
+        }
+
+        bool contains(const value_type& val) const
+        {
+            return find(val) != end();
+        }
+
         iterator lower_bound(const value_type& val) const
         {
             return rb_tree_.lower_bound(val);
@@ -78,6 +298,66 @@ namespace stl
             return rb_tree_.upper_bound(val);
         }
 
+        // Keys between lo and hi, bounds tells whether lo and hi themselves are included
+        RangeView<iterator> range(const value_type& lo,
+                                  const value_type& hi,
+                                  Bounds bounds = Bounds::Closed) const
+        {
+            return rb_tree_.range(lo, hi, bounds);
+        }
+
+        // Combines the keys of range(lo, hi, bounds) in ascending order in O(log n),
+        // requires AggregateTraits, e.g. Set<int, AggregateTraits<int, SumMonoid<int>>>
+        typename RedBlackTree<value_type, TTraits>::aggregate_type
+        aggregate(const value_type& lo, const value_type& hi, Bounds bounds = Bounds::Closed) const
+        {
+            return rb_tree_.aggregate(lo, hi, bounds);
+        }
+
+        // Calls fn for every key of range(lo, hi, bounds) in ascending order,
+        // faster than iterating the range view for long ranges
+        template <typename TFunc>
+        void for_each_range(const value_type& lo,
+                            const value_type& hi,
+                            TFunc fn,
+                            Bounds bounds = Bounds::Closed) const
+        {
+            rb_tree_.for_each_range(lo, hi, bounds, fn);
+        }
+
+        // Writes to out iterators cutting range(lo, hi, bounds) into up to 2^depth
+        // runs of whole subtrees, see parallel.hpp
+        template <class _OutputIterator>
+        _OutputIterator split_points(const value_type& lo,
+                                     const value_type& hi,
+                                     size_t depth,
+                                     _OutputIterator out,
+                                     Bounds bounds = Bounds::Closed) const
+        {
+            return rb_tree_.split_points(lo, hi, bounds, depth, out);
+        }
+
+        // Looks up every key of keys and writes find() result for it to out.
+        // Lookups are pipelined, which is much faster for large batches than
+        // calling find() in a loop.
+        template <typename TKeys, class _OutputIterator>
+        _OutputIterator find_many(const TKeys& keys, _OutputIterator out) const
+        {
+            return rb_tree_.find_many(std::begin(keys), std::end(keys), out);
+        }
+
+        template <typename TKeys, class _OutputIterator>
+        _OutputIterator lower_bound_many(const TKeys& keys, _OutputIterator out) const
+        {
+            return rb_tree_.lower_bound_many(std::begin(keys), std::end(keys), out);
+        }
+
+        // Cursor positioned at begin(), see Cursor
+        Cursor cursor()
+        {
+            return Cursor(*this);
+        }
+
         size_t size() const
         {
             return rb_tree_.size();
@@ -87,5 +367,150 @@ namespace stl
         {
             return rb_tree_.empty();
         }
+
+     private:
+        bool filter_may_contain(const value_type& val) const
+        {
+            ++filter_counters_.lookups;
+            if (!filter_->may_contain(val)) {
+                ++filter_counters_.rejected;
+                return false;
+            }
+            return true;
+        }
+
+        // An overfilled filter loses selectivity, it is rebuilt at a larger size
+        void filter_add(const value_type& val)
+        {
+            if constexpr (is_hashable_v<value_type>) {
+                if (filter_) {
+                    filter_->add(val);
+                    if (size() > filter_->capacity()) {
+                        rebuild_filter();
+                    }
+                }
+            }
+        }
+
+        // Erased keys are never removed from the filter, it is rebuilt once they
+        // make a noticeable share
+        void filter_erased(size_t count)
+        {
+            if constexpr (is_hashable_v<value_type>) {
+                if (filter_ && count) {
+                    filter_stale_keys_ += count;
+                    if (filter_stale_keys_ > size() / 4 + 16) {
+                        rebuild_filter();
+                    }
+                }
+            }
+        }
+
+        // Drops the cached nodes which erasing the key of pos may free or change: the
+        // node of pos and, when keys are copied on erase, the node of the next key
+        void uncache(iterator pos)
+        {
+            if constexpr (is_hashable_v<value_type>) {
+                if (cache_) {
+                    cache_->erase(*pos);
+                    if constexpr (copy_keys_on_erase_v<TKey, TTraits>) {
+                        if (++pos != end()) {
+                            cache_->erase(*pos);
+                        }
+                    }
+                }
+            }
+        }
+
+        void uncache(const value_type& val)
+        {
+            if constexpr (is_hashable_v<value_type>) {
+                if (cache_) {
+                    cache_->erase(val);
+                    if constexpr (copy_keys_on_erase_v<TKey, TTraits>) {
+                        if (auto next = rb_tree_.upper_bound(val); next != end()) {
+                            cache_->erase(*next);
+                        }
+                    }
+                }
+            }
+        }
+
+        void rebuild_filter()
+        {
+            filter_->reset(size() + size() / 4);
+            for (const auto& key: rb_tree_) {
+                filter_->add(key);
+            }
+            filter_stale_keys_ = 0;
+        }
+    };
+
+
+    ///////////////////////////////////////////////////////////////////////////////
+    /// Class Set::Cursor
+    ///////////////////////////////////////////////////////////////////////////////
+
+    // Remembers a position in a set. seek() moves to the lower bound of a key in
+    // O(log d) for a key d positions away, insert() and erase() work next to the
+    // position without descending from the root. Suits merging a sorted stream
+    // against the set. Erasing other keys invalidates the cursor if its key is erased.
+
+    template <typename TKey, typename TTraits>
+    class Set<TKey, TTraits>::Cursor
+    {
+        Set* set_;
+        iterator pos_;
+
+     public:
+        explicit Cursor(Set& set) : set_(&set), pos_(set.begin()) { }
+
+        iterator position() const
+        {
+            return pos_;
+        }
+
+        bool at_end() const
+        {
+            return pos_ == set_->end();
+        }
+
+        const value_type& operator*() const
+        {
+            return *pos_;
+        }
+
+        Cursor& operator++()
+        {
+            ++pos_;
+            return *this;
+        }
+
+        Cursor& operator--()
+        {
+            --pos_;
+            return *this;
+        }
+
+        // Moves to the first key that is not less than val
+        iterator seek(const value_type& val)
+        {
+            pos_ = set_->rb_tree_.seek(pos_, val);
+            return pos_;
+        }
+
+        // Inserts val if it is absent and moves to it
+        iterator insert(const value_type& val)
+        {
+            pos_ = set_->insert(pos_, val);
+            return pos_;
+        }
+
+        // Erases the key at the position and moves to the next one
+        iterator erase()
+        {
+            pos_ = set_->erase(pos_);
+            return pos_;
+        }
     };
 }
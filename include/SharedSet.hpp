@@ -0,0 +1,245 @@
+#pragma once
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <string>
+#include <system_error>
+#include <type_traits>
+
+#include "Set.hpp"
+#include "flat_search.hpp"
+
+namespace stl
+{
+    ///////////////////////////////////////////////////////////////////////////////
+    /// Template class SharedSet
+    ///////////////////////////////////////////////////////////////////////////////
+
+    // Read-only snapshot of a set placed in a POSIX shared-memory segment.
+    // One process publishes a built Set with create(), any number of processes
+    // attach to it with open() and query it concurrently without copying keys.
+    //
+    // Segment layout: SharedSetHeader followed by the keys in ascending order.
+    // The header stores offsets from the beginning of the segment instead of
+    // pointers, so the segment can be mapped at a different address in every
+    // process. Keys must be trivially copyable for the same reason.
+
+    struct SharedSetHeader
+    {
+        static constexpr uint64_t kMagic = 0x7465537465726853;
+
+        std::atomic<uint64_t> magic;
+        uint64_t key_size;
+        uint64_t nodes_count;
+        uint64_t keys_offset;
+    };
+
+    template <typename TKey>
+    class SharedSet
+    {
+        static_assert(std::is_trivially_copyable_v<TKey>,
+                      "SharedSet keys are copied bytewise into shared memory");
+
+     public:
+        typedef TKey value_type;
+        typedef const TKey* iterator;
+
+        SharedSet(const SharedSet&) = delete;
+        SharedSet& operator=(const SharedSet&) = delete;
+
+        SharedSet(SharedSet&& other) noexcept
+            : segment_(other.segment_), segment_size_(other.segment_size_)
+        {
+            other.segment_ = nullptr;
+            other.segment_size_ = 0;
+        }
+
+        SharedSet& operator=(SharedSet&& other) noexcept
+        {
+            if (&other != this) {
+                unmap();
+                segment_ = other.segment_, segment_size_ = other.segment_size_;
+                other.segment_ = nullptr, other.segment_size_ = 0;
+            }
+            return *this;
+        }
+
+        ~SharedSet()
+        {
+            unmap();
+        }
+
+        // Writer side: copies the keys of set into a new segment called name.
+        // Fails if a segment with that name already exists.
+        template <typename TTraits>
+        static SharedSet create(const std::string& name, const Set<TKey, TTraits>& set);
+
+        // Reader side: maps an already published segment read-only.
+        static SharedSet open(const std::string& name);
+
+        // Removes the name of the segment, mappings stay valid until unmapped.
+        static void remove(const std::string& name);
+
+        iterator find(const value_type& val) const
+        {
+            auto it = lower_bound(val);
+            return (it != end() && !(val < *it)) ? it : end();
+        }
+
+        bool contains(const value_type& val) const
+        {
+            return find(val) != end();
+        }
+
+        iterator lower_bound(const value_type& val) const
+        {
+            return branchless_lower_bound(begin(), size(), val);
+        }
+
+        iterator upper_bound(const value_type& val) const
+        {
+            return branchless_upper_bound(begin(), size(), val);
+        }
+
+        iterator begin() const
+        {
+            return reinterpret_cast<iterator>(static_cast<const char*>(segment_) + header()->keys_offset);
+        }
+
+        iterator end() const
+        {
+            return begin() + size();
+        }
+
+        size_t size() const
+        {
+            return header()->nodes_count;
+        }
+
+        bool empty() const
+        {
+            return size() == 0;
+        }
+
+     private:
+        void* segment_;
+        size_t segment_size_;
+
+        SharedSet(void* segment, size_t segment_size) : segment_(segment), segment_size_(segment_size) { }
+
+        const SharedSetHeader* header() const
+        {
+            return static_cast<const SharedSetHeader*>(segment_);
+        }
+
+        static size_t keys_offset()
+        {
+            return (sizeof(SharedSetHeader) + alignof(TKey) - 1) / alignof(TKey) * alignof(TKey);
+        }
+
+        static std::system_error error(const std::string& what)
+        {
+            return std::system_error(errno, std::generic_category(), what);
+        }
+
+        void unmap()
+        {
+            if (segment_) {
+                munmap(segment_, segment_size_);
+                segment_ = nullptr;
+            }
+        }
+    };
+
+
+    ///////////////////////////////////////////////////////////////////////////////
+    /// Implementation of template class SharedSet
+    ///////////////////////////////////////////////////////////////////////////////
+
+    template <typename TKey>
+    template <typename TTraits>
+    SharedSet<TKey> SharedSet<TKey>::create(const std::string& name, const Set<TKey, TTraits>& set)
+    {
+        int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, S_IRUSR | S_IWUSR);
+        if (fd < 0) {
+            throw error("shm_open " + name);
+        }
+
+        size_t segment_size = keys_offset() + set.size() * sizeof(TKey);
+        if (ftruncate(fd, segment_size) < 0) {
+            auto err = error("ftruncate " + name);
+            close(fd), shm_unlink(name.c_str());
+            throw err;
+        }
+        void* segment = mmap(nullptr, segment_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (segment == MAP_FAILED) {
+            auto err = error("mmap " + name);
+            shm_unlink(name.c_str());
+            throw err;
+        }
+
+        auto header = new (segment) SharedSetHeader();
+        header->key_size = sizeof(TKey);
+        header->nodes_count = set.size();
+        header->keys_offset = keys_offset();
+        auto keys = reinterpret_cast<TKey*>(static_cast<char*>(segment) + keys_offset());
+        for (const auto& key: set) {
+            std::memcpy(static_cast<void*>(keys++), &key, sizeof(TKey));
+        }
+        // readers check the magic last, so a half-written segment is never used
+        header->magic.store(SharedSetHeader::kMagic, std::memory_order_release);
+
+        return SharedSet(segment, segment_size);
+    }
+
+    template <typename TKey>
+    SharedSet<TKey> SharedSet<TKey>::open(const std::string& name)
+    {
+        int fd = shm_open(name.c_str(), O_RDONLY, 0);
+        if (fd < 0) {
+            throw error("shm_open " + name);
+        }
+        struct stat st;
+        if (fstat(fd, &st) < 0) {
+            auto err = error("fstat " + name);
+            close(fd);
+            throw err;
+        }
+        size_t segment_size = st.st_size;
+        if (segment_size < keys_offset()) {
+            close(fd);
+            throw std::system_error(EINVAL, std::generic_category(), "truncated segment " + name);
+        }
+        void* segment = mmap(nullptr, segment_size, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (segment == MAP_FAILED) {
+            throw error("mmap " + name);
+        }
+
+        SharedSet result(segment, segment_size);
+        auto header = result.header();
+        if (header->magic.load(std::memory_order_acquire) != SharedSetHeader::kMagic ||
+            header->key_size != sizeof(TKey) ||
+            header->keys_offset + header->nodes_count * sizeof(TKey) > segment_size) {
+            throw std::system_error(EINVAL, std::generic_category(), "not a published set " + name);
+        }
+        return result;
+    }
+
+    template <typename TKey>
+    void SharedSet<TKey>::remove(const std::string& name)
+    {
+        if (shm_unlink(name.c_str()) < 0 && errno != ENOENT) {
+            throw error("shm_unlink " + name);
+        }
+    }
+}
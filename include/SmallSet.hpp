@@ -0,0 +1,312 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include "redblacktree.hpp"
+
+namespace stl
+{
+    ///////////////////////////////////////////////////////////////////////////////
+    /// Template class SmallSet
+    ///////////////////////////////////////////////////////////////////////////////
+
+    // Set which keeps up to N keys sorted in an array inside the object and
+    // moves them to a RedBlackTree when it grows past N. Tiny sets then need no
+    // allocation and are searched without chasing pointers. The set goes back to
+    // the array when it shrinks to N / 2 keys, the gap keeps a set whose size
+    // hovers around N from moving its keys back and forth.
+    //
+    // In the array mode insert and erase invalidate iterators past the changed
+    // key, and switching modes invalidates all iterators. It is a separate
+    // container so that Set iterators stay a single node pointer.
+
+    template <typename TKey, size_t N = 16, typename TTraits = TreeTraits<TKey>>
+    class SmallSet
+    {
+        static_assert(N > 0, "SmallSet needs room for at least one inline key");
+
+        typedef RedBlackTree<TKey, TTraits> tree_type;
+        typedef typename tree_type::_Base_ptr _Base_ptr;
+
+        std::array<TKey, N> keys_;
+        size_t size_;
+        bool in_tree_;
+        tree_type rb_tree_;
+
+     public:
+        typedef TKey value_type;
+        class iterator;
+        typedef std::reverse_iterator<iterator> reverse_iterator;
+
+        SmallSet() : keys_(), size_(0), in_tree_(false) { }
+
+        template <class _InputIterator>
+        SmallSet(_InputIterator first, _InputIterator last) : SmallSet()
+        {
+            for (; first != last; ++first) {
+                insert(*first);
+            }
+        }
+
+        explicit SmallSet(const std::initializer_list<value_type>& l) : SmallSet(l.begin(), l.end()) { }
+
+        static constexpr size_t inline_capacity()
+        {
+            return N;
+        }
+
+        // Whether the keys are in the tree rather than in the inline array
+        bool is_tree() const
+        {
+            return in_tree_;
+        }
+
+        void clear()
+        {
+            rb_tree_.clear();
+            size_ = 0;
+            in_tree_ = false;
+        }
+
+        void insert(const value_type& val)
+        {
+            if (in_tree_) {
+                rb_tree_.insert(val);
+                return;
+            }
+            size_t pos = inline_lower_bound(val);
+            if (pos < size_ && !(val < keys_[pos])) {
+                return;
+            }
+            if (size_ == N) {
+                to_tree();
+                rb_tree_.insert(val);
+                return;
+            }
+            for (size_t i(size_); i > pos; i--) {
+                keys_[i] = keys_[i - 1];
+            }
+            keys_[pos] = val;
+            size_++;
+        }
+
+        void erase(const value_type& val)
+        {
+            if (in_tree_) {
+                rb_tree_.erase(val);
+                if (rb_tree_.size() <= N / 2) {
+                    to_array();
+                }
+                return;
+            }
+            size_t pos = inline_lower_bound(val);
+            if (pos < size_ && !(val < keys_[pos])) {
+                erase_inline(pos);
+            }
+        }
+
+        iterator erase(iterator pos)
+        {
+            if (!in_tree_) {
+                erase_inline(pos.key_ - keys_.data());
+                return pos;
+            }
+            auto next = rb_tree_.erase(typename tree_type::iterator(pos.node_));
+            if (rb_tree_.size() > N / 2) {
+                return iterator(next.node);
+            }
+            if (next == rb_tree_.end()) {
+                to_array();
+                return end();
+            }
+            value_type next_key = *next;
+            to_array();
+            return lower_bound(next_key);
+        }
+
+        iterator find(const value_type& val) const
+        {
+            auto it = lower_bound(val);
+            return (it != end() && !(val < *it)) ? it : end();
+        }
+
+        bool contains(const value_type& val) const
+        {
+            return find(val) != end();
+        }
+
+        iterator lower_bound(const value_type& val) const
+        {
+            if (in_tree_) {
+                return iterator(rb_tree_.lower_bound(val).node);
+            }
+            return iterator(keys_.data() + inline_lower_bound(val));
+        }
+
+        iterator upper_bound(const value_type& val) const
+        {
+            if (in_tree_) {
+                return iterator(rb_tree_.upper_bound(val).node);
+            }
+            size_t pos(0);
+            for (size_t i(0); i < size_; i++) {
+                pos += !(val < keys_[i]);
+            }
+            return iterator(keys_.data() + pos);
+        }
+
+        iterator begin() const
+        {
+            return in_tree_ ? iterator(rb_tree_.begin().node) : iterator(keys_.data());
+        }
+
+        iterator end() const
+        {
+            return in_tree_ ? iterator(rb_tree_.end().node) : iterator(keys_.data() + size_);
+        }
+
+        reverse_iterator rbegin() const
+        {
+            return reverse_iterator(end());
+        }
+
+        reverse_iterator rend() const
+        {
+            return reverse_iterator(begin());
+        }
+
+        size_t size() const
+        {
+            return in_tree_ ? rb_tree_.size() : size_;
+        }
+
+        bool empty() const
+        {
+            return size() == 0;
+        }
+
+     private:
+        // Counts the smaller keys instead of branching on every comparison, the
+        // loop has no early exit and the compiler can vectorize it
+        size_t inline_lower_bound(const value_type& val) const
+        {
+            size_t pos(0);
+            for (size_t i(0); i < size_; i++) {
+                pos += keys_[i] < val;
+            }
+            return pos;
+        }
+
+        void erase_inline(size_t pos)
+        {
+            for (size_t i(pos + 1); i < size_; i++) {
+                keys_[i - 1] = keys_[i];
+            }
+            size_--;
+        }
+
+        // Keys are in order, so every hinted insert lands next to the rightmost node
+        void to_tree()
+        {
+            for (size_t i(0); i < size_; i++) {
+                rb_tree_.insert(rb_tree_.end(), keys_[i]);
+            }
+            size_ = 0;
+            in_tree_ = true;
+        }
+
+        void to_array()
+        {
+            size_ = 0;
+            for (const auto& key: rb_tree_) {
+                keys_[size_++] = key;
+            }
+            rb_tree_.clear();
+            in_tree_ = false;
+        }
+    };
+
+
+    ///////////////////////////////////////////////////////////////////////////////
+    /// Class SmallSet::iterator
+    ///////////////////////////////////////////////////////////////////////////////
+
+    // Points either into the inline array or to a tree node, node_ tells which
+
+    template <typename TKey, size_t N, typename TTraits>
+    class SmallSet<TKey, N, TTraits>::iterator
+    {
+        friend class SmallSet;
+
+        const TKey* key_;
+        _Base_ptr node_;
+
+        explicit iterator(const TKey* key) : key_(key), node_(nullptr) { }
+        explicit iterator(_Base_ptr node) : key_(nullptr), node_(node) { }
+
+     public:
+        typedef std::bidirectional_iterator_tag iterator_category;
+        typedef std::ptrdiff_t difference_type;
+        typedef TKey value_type;
+        typedef const TKey* pointer;
+        typedef const TKey& reference;
+
+        iterator() : key_(nullptr), node_(nullptr) { }
+
+        reference operator*() const
+        {
+            return node_ ? node_->key : *key_;
+        }
+
+        pointer operator->() const
+        {
+            return &**this;
+        }
+
+        iterator& operator++()
+        {
+            if (node_) {
+                node_ = node_->nextNode();
+            } else {
+                ++key_;
+            }
+            return *this;
+        }
+
+        iterator operator++(int)
+        {
+            iterator tmp = *this;
+            ++*this;
+            return tmp;
+        }
+
+        iterator& operator--()
+        {
+            if (node_) {
+                node_ = node_->prevNode();
+            } else {
+                --key_;
+            }
+            return *this;
+        }
+
+        iterator operator--(int)
+        {
+            iterator tmp = *this;
+            --*this;
+            return tmp;
+        }
+
+        friend bool operator==(const iterator& left, const iterator& right)
+        {
+            return left.key_ == right.key_ && left.node_ == right.node_;
+        }
+
+        friend bool operator!=(const iterator& left, const iterator& right)
+        {
+            return !(left == right);
+        }
+    };
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <stdexcept>
+#include "flat_search.hpp"
+
+namespace stl
+{
+    ///////////////////////////////////////////////////////////////////////////////
+    /// Template class StaticSet
+    ///////////////////////////////////////////////////////////////////////////////
+
+    // Set of at most N keys known at compile time, e.g. reserved words:
+    //     constexpr stl::StaticSet<std::string_view, 3> words{"for", "if", "while"};
+    //     constexpr stl::StaticSet primes{7, 2, 5, 3};  // StaticSet<int, 4>
+    // The keys are sorted and deduplicated by the constexpr constructor into a
+    // flat array, so the set needs no allocation and no static initialization.
+    // Lookups use the branchless binary search of flat_search.hpp.
+
+    template <typename TKey, size_t N>
+    class StaticSet
+    {
+        std::array<TKey, N> keys_;
+        size_t size_;
+
+     public:
+        typedef TKey value_type;
+        typedef const TKey* iterator;
+        typedef std::reverse_iterator<iterator> reverse_iterator;
+
+        constexpr StaticSet() : keys_(), size_(0) { }
+
+        constexpr StaticSet(std::initializer_list<value_type> l) : keys_(), size_(0)
+        {
+            if (l.size() > N) {
+                throw std::length_error("stl::StaticSet: too many keys");
+            }
+            // insertion sort, N is small and std::sort is not constexpr in C++17
+            for (const auto& val: l) {
+                size_t pos(size_);
+                while (pos > 0 && val < keys_[pos - 1]) {
+                    pos--;
+                }
+                if (pos > 0 && !(keys_[pos - 1] < val)) {
+                    continue;
+                }
+                for (size_t i(size_); i > pos; i--) {
+                    keys_[i] = keys_[i - 1];
+                }
+                keys_[pos] = val;
+                size_++;
+            }
+        }
+
+        constexpr iterator find(const value_type& val) const
+        {
+            auto it = lower_bound(val);
+            return (it != end() && !(val < *it)) ? it : end();
+        }
+
+        constexpr bool contains(const value_type& val) const
+        {
+            return find(val) != end();
+        }
+
+        constexpr iterator lower_bound(const value_type& val) const
+        {
+            return branchless_lower_bound(begin(), size_, val);
+        }
+
+        constexpr iterator upper_bound(const value_type& val) const
+        {
+            return branchless_upper_bound(begin(), size_, val);
+        }
+
+        constexpr iterator begin() const
+        {
+            return keys_.data();
+        }
+
+        constexpr iterator end() const
+        {
+            return keys_.data() + size_;
+        }
+
+        reverse_iterator rbegin() const
+        {
+            return reverse_iterator(end());
+        }
+
+        reverse_iterator rend() const
+        {
+            return reverse_iterator(begin());
+        }
+
+        constexpr size_t size() const
+        {
+            return size_;
+        }
+
+        constexpr bool empty() const
+        {
+            return size_ == 0;
+        }
+    };
+
+    template <typename TKey, typename... TKeys>
+    StaticSet(TKey, TKeys...) -> StaticSet<TKey, 1 + sizeof...(TKeys)>;
+}
@@ -1,9 +1,18 @@
 #pragma once
 
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
 namespace stl
 {
     enum class Color { Red = false, Black = true };
 
+    // Index of a child in Node::child. A comparison result indexes it directly,
+    // e.g. node->child[node->key < key], and a mirrored case is the same code
+    // with the direction flipped.
+    enum Side { Left = 0, Right = 1 };
+
     template <typename TKey>
     struct Node
     {
@@ -13,17 +22,24 @@ namespace stl
 
         TKey key;
         Color color;
-        _Base_ptr parent, lchild, rchild;
+        _Base_ptr parent;
+        _Base_ptr child[2];
 
-        Node() : key(), color(Color::Red), parent(nullptr), lchild(nullptr), rchild(nullptr) { }
+        Node() : key(), color(Color::Red), parent(nullptr), child{nullptr, nullptr} { }
 
         explicit Node(const TKey& val,
                       Color c = Color::Red)
                       : key(val)
                       , color(c)
                       , parent(nullptr)
-                      , lchild(nullptr)
-                      , rchild(nullptr) { }
+                      , child{nullptr, nullptr} { }
+
+        template <typename... Args>
+        explicit Node(std::in_place_t, Args&&... args)
+            : key(std::forward<Args>(args)...)
+            , color(Color::Red)
+            , parent(nullptr)
+            , child{nullptr, nullptr} { }
 
         void repaint()
         {
@@ -35,46 +51,38 @@ namespace stl
             color = c;
         }
 
-        inline bool is_rchild(_Base_ptr child) const
+        inline bool is_rchild(_Base_ptr node) const
         {
-            return this->rchild == child;
+            return this->child[Right] == node;
         }
 
-        inline bool is_lchild(_Base_ptr child) const
+        inline bool is_lchild(_Base_ptr node) const
         {
-            return this->lchild == child;
+            return this->child[Left] == node;
         }
 
         _Base_ptr nextNode()
         {
-            auto iter = this;
-            if (iter->rchild) {
-                iter = iter->rchild;
-                while (iter->lchild)
-                    iter = iter->lchild;
-            } else {
-                _Base_ptr parent = iter->parent;
-                while (parent->is_rchild(iter)) {
-                    iter = parent;
-                    parent = parent->parent;
-                }
-                if (!is_header(iter))
-                    iter = parent;
-            }
-
-            return iter;
+            return step(Right);
         }
 
         _Base_ptr prevNode()
+        {
+            return step(Left);
+        }
+
+        // In-order neighbour on side dir: the nearest node of the subtree on that
+        // side, or the first ancestor reached from the other side
+        _Base_ptr step(bool dir)
         {
             auto iter = this;
-            if (iter->lchild) {
-                iter = iter->lchild;
-                while (iter->rchild)
-                    iter = iter->rchild;
+            if (iter->child[dir]) {
+                iter = iter->child[dir];
+                while (iter->child[!dir])
+                    iter = iter->child[!dir];
             } else {
                 _Base_ptr parent = iter->parent;
-                while (parent->is_lchild(iter)) {
+                while (parent->child[dir] == iter) {
                     iter = parent;
                     parent = parent->parent;
                 }
@@ -86,8 +94,26 @@ namespace stl
         }
     };
 
+    // Node linked to its in-order neighbours, so iterators step in O(1)
+    template <typename TBase>
+    struct ThreadedNode : TBase
+    {
+        typename TBase::_Base_ptr next = nullptr, prev = nullptr;
+
+        using TBase::TBase;
+    };
+
+    // Node which also keeps the aggregate of the keys of its subtree
+    template <typename TBase, typename TSummary>
+    struct AggregateNode : TBase
+    {
+        TSummary summary;
+
+        using TBase::TBase;
+    };
+
     // Helper type to manage header and nodes_count
-    template <typename TKey>
+    template <typename TKey, typename TNode = Node<TKey>>
     struct RedBlackTreeHeader
     {
         // header address is end() of the container
@@ -97,7 +123,7 @@ namespace stl
 
         typedef Node<TKey>* _Base_ptr;
 
-        Node<TKey> data;
+        TNode data;
         size_t nodes_count;
 
         RedBlackTreeHeader()
@@ -110,7 +136,11 @@ namespace stl
         {
             nodes_count = 0;
             data.parent = nullptr;
-            data.lchild = data.rchild = &data;
+            data.child[Left] = data.child[Right] = &data;
+            // in threaded trees the header closes the list of nodes into a ring
+            if constexpr (std::is_base_of_v<ThreadedNode<Node<TKey>>, TNode>) {
+                data.next = data.prev = &data;
+            }
         }
     };
 
@@ -124,6 +154,8 @@ namespace stl
     template<typename TKey>
     inline bool is_header(const Node<TKey>* node)
     {
-        return !node->parent || (node->lchild && node->rchild && !(node->lchild->key < node->rchild->key));
+        // the header is the only red node whose parent links back to it: the root
+        // is always black, so keys are never compared here
+        return !node->parent || (node->color == Color::Red && node->parent->parent == node);
     }
 }
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "hashing.hpp"
+
+namespace stl
+{
+    // Counters of a membership filter placed in front of a container lookup
+    struct FilterStats
+    {
+        size_t memory_bytes = 0;
+        double bits_per_key = 0;
+        size_t lookups = 0;          // lookups that consulted the filter
+        size_t rejected = 0;         // lookups answered by the filter alone
+        size_t false_positives = 0;  // lookups passed by the filter but missed in the container
+        double expected_false_positive_rate = 0;
+
+        // Share of absent keys that the filter failed to reject
+        double false_positive_rate() const
+        {
+            auto negatives = rejected + false_positives;
+            return negatives ? double(false_positives) / negatives : 0;
+        }
+    };
+
+    ///////////////////////////////////////////////////////////////////////////////
+    /// Template class BlockedBloomFilter
+    ///////////////////////////////////////////////////////////////////////////////
+
+    // Bloom filter split into cache-line sized blocks: all probe bits of a key are
+    // set in the same block, so a query costs a single cache miss. Keys can only be
+    // added, erasures are tracked by the owner which rebuilds the filter from time
+    // to time.
+
+    template <typename TKey, typename THash = std::hash<TKey>>
+    class BlockedBloomFilter
+    {
+     public:
+        static constexpr size_t kBlockBits = 512;
+
+        explicit BlockedBloomFilter(double bits_per_key = 10, size_t capacity = 0)
+            : bits_per_key_(bits_per_key), hashes_count_(), capacity_(), keys_count_()
+        {
+            if (!(bits_per_key > 0) || !std::isfinite(bits_per_key)) {
+                throw std::invalid_argument("stl::BlockedBloomFilter: bits_per_key must be positive");
+            }
+            // k = ln(2) * m / n minimizes the false positive rate
+            size_t optimal_hashes = std::lround(bits_per_key * std::log(2.0));
+            hashes_count_ = std::min<size_t>(16, std::max<size_t>(1, optimal_hashes));
+            reset(capacity);
+        }
+
+        // Drops all keys and resizes the filter to hold capacity keys at bits_per_key
+        void reset(size_t capacity)
+        {
+            capacity_ = std::max<size_t>(capacity, kBlockBits / bits_per_key_);
+            keys_count_ = 0;
+            size_t blocks_count = std::ceil(capacity_ * bits_per_key_ / kBlockBits);
+            blocks_.assign(blocks_count, Block());
+        }
+
+        void add(const TKey& key)
+        {
+            auto hash = mix_hash(THash()(key));
+            auto& block = blocks_[block_index(hash)];
+            uint32_t h1(hash), h2(second_hash(hash));
+            for (size_t i(0); i < hashes_count_; i++, h1 += h2) {
+                block[(h1 % kBlockBits) / 64] |= uint64_t(1) << (h1 % 64);
+            }
+            keys_count_++;
+        }
+
+        bool may_contain(const TKey& key) const
+        {
+            auto hash = mix_hash(THash()(key));
+            const auto& block = blocks_[block_index(hash)];
+            uint32_t h1(hash), h2(second_hash(hash));
+            bool present(true);
+            for (size_t i(0); i < hashes_count_; i++, h1 += h2) {
+                present &= (block[(h1 % kBlockBits) / 64] >> (h1 % 64)) & 1;
+            }
+            return present;
+        }
+
+        size_t capacity() const
+        {
+            return capacity_;
+        }
+
+        size_t keys_count() const
+        {
+            return keys_count_;
+        }
+
+        double bits_per_key() const
+        {
+            return bits_per_key_;
+        }
+
+        size_t memory_usage() const
+        {
+            return blocks_.size() * sizeof(Block);
+        }
+
+        // Classic (1 - e^(-kn/m))^k estimate for the keys added so far
+        double expected_false_positive_rate() const
+        {
+            double bits = blocks_.size() * kBlockBits;
+            return std::pow(1 - std::exp(-double(hashes_count_ * keys_count_) / bits), hashes_count_);
+        }
+
+     private:
+        typedef std::array<uint64_t, kBlockBits / 64> Block;
+
+        std::vector<Block> blocks_;
+        double bits_per_key_;
+        size_t hashes_count_;
+        size_t capacity_;
+        size_t keys_count_;
+
+        // odd step of the double hashing sequence, independent of the block index
+        static uint32_t second_hash(uint64_t hash)
+        {
+            return uint32_t((hash * 0x9e3779b97f4a7c15ULL) >> 32) | 1;
+        }
+
+        size_t block_index(uint64_t hash) const
+        {
+            return ((hash >> 32) * blocks_.size()) >> 32;
+        }
+    };
+}
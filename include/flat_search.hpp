@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+
+namespace stl
+{
+    ///////////////////////////////////////////////////////////////////////////////
+    /// Search helpers for sorted contiguous storage
+    ///////////////////////////////////////////////////////////////////////////////
+
+    // Both functions halve the range on every step without a data-dependent branch,
+    // so the compiler emits a cmov instead of a hard to predict jump.
+
+    template <typename TKey>
+    constexpr const TKey* branchless_lower_bound(const TKey* first, size_t count, const TKey& key)
+    {
+        if (!count) {
+            return first;
+        }
+        while (count > 1) {
+            size_t half = count / 2;
+            first = (first[half] < key) ? first + half : first;
+            count -= half;
+        }
+        return first + (*first < key);
+    }
+
+    template <typename TKey>
+    constexpr const TKey* branchless_upper_bound(const TKey* first, size_t count, const TKey& key)
+    {
+        if (!count) {
+            return first;
+        }
+        while (count > 1) {
+            size_t half = count / 2;
+            first = !(key < first[half]) ? first + half : first;
+            count -= half;
+        }
+        return first + !(key < *first);
+    }
+}
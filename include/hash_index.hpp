@@ -0,0 +1,174 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "hashing.hpp"
+
+namespace stl
+{
+    ///////////////////////////////////////////////////////////////////////////////
+    /// Template class HashIndex
+    ///////////////////////////////////////////////////////////////////////////////
+
+    // Open-addressing hash table of nodes keyed by the keys they hold, with linear
+    // probing. Every slot has a node pointer and a one-byte tag: empty, deleted,
+    // or 7 bits of the hash of the key. Probing scans the tags and dereferences a
+    // node only when its tag matches, so a lookup usually touches one line of tags
+    // and the node it returns.
+    //
+    // A slot takes 9 bytes. The table doubles once live and deleted slots exceed
+    // 7/8 of it, and an erase which leaves less than 1/4 of it live shrinks it to
+    // be half full. So it holds between 8/7 and 4 slots per key, 10.3 to 36 bytes
+    // per key, and at most 16/7 slots (20.6 bytes) after inserts alone. The index
+    // does not own the nodes, the owner removes a key before freeing its node.
+
+    template <typename TKey, typename TNodePtr, typename THash = std::hash<TKey>>
+    class HashIndex
+    {
+     public:
+        HashIndex() : size_(0), deleted_(0)
+        {
+            reset(kMinSlots);
+        }
+
+        // Node holding key or nullptr
+        TNodePtr find(const TKey& key) const
+        {
+            auto hash = mix_hash(THash()(key));
+            uint8_t tag = tag_of(hash);
+            for (size_t slot = hash & mask(); tags_[slot] != kEmpty; slot = (slot + 1) & mask()) {
+                if (tags_[slot] == tag && keys_equal(nodes_[slot]->key, key)) {
+                    return nodes_[slot];
+                }
+            }
+            return nullptr;
+        }
+
+        // Indexes node under key, key must be absent
+        void insert(const TKey& key, TNodePtr node)
+        {
+            if ((size_ + deleted_ + 1) * 8 > tags_.size() * 7) {
+                // rehashing in place is enough when deleted slots take the room
+                rehash(size_ * 16 > tags_.size() * 7 ? tags_.size() * 2 : tags_.size());
+            }
+            place(mix_hash(THash()(key)), node);
+            size_++;
+        }
+
+        // Removes key and returns its node or nullptr
+        TNodePtr erase(const TKey& key)
+        {
+            auto hash = mix_hash(THash()(key));
+            uint8_t tag = tag_of(hash);
+            for (size_t slot = hash & mask(); tags_[slot] != kEmpty; slot = (slot + 1) & mask()) {
+                if (tags_[slot] == tag && keys_equal(nodes_[slot]->key, key)) {
+                    auto node = nodes_[slot];
+                    tags_[slot] = kDeleted;
+                    nodes_[slot] = nullptr;
+                    size_--, deleted_++;
+                    if (size_ * 4 < tags_.size() && tags_.size() > kMinSlots) {
+                        rehash(slots_for(size_));
+                    }
+                    return node;
+                }
+            }
+            return nullptr;
+        }
+
+        // Points key, held by node, to other. Nodes are compared by address, so node
+        // may already be freed.
+        void replace(const TKey& key, TNodePtr node, TNodePtr other)
+        {
+            auto hash = mix_hash(THash()(key));
+            for (size_t slot = hash & mask(); tags_[slot] != kEmpty; slot = (slot + 1) & mask()) {
+                if (nodes_[slot] == node) {
+                    nodes_[slot] = other;
+                    return;
+                }
+            }
+        }
+
+        void clear()
+        {
+            reset(kMinSlots);
+        }
+
+        size_t size() const
+        {
+            return size_;
+        }
+
+        size_t memory_usage() const
+        {
+            return tags_.size() * (sizeof(uint8_t) + sizeof(TNodePtr));
+        }
+
+     private:
+        static constexpr size_t kMinSlots = 16;
+        static constexpr uint8_t kEmpty = 0;
+        static constexpr uint8_t kDeleted = 1;
+
+        std::vector<uint8_t> tags_;
+        std::vector<TNodePtr> nodes_;
+        size_t size_;
+        size_t deleted_;
+
+        size_t mask() const
+        {
+            return tags_.size() - 1;
+        }
+
+        // the low bits pick the slot, the tag takes the top ones
+        static uint8_t tag_of(uint64_t hash)
+        {
+            return uint8_t(hash >> 57) | 0x80;
+        }
+
+        // Smallest table at most half full with count keys
+        static size_t slots_for(size_t count)
+        {
+            size_t slots = kMinSlots;
+            while (slots < count * 2) {
+                slots *= 2;
+            }
+            return slots;
+        }
+
+        void reset(size_t slots)
+        {
+            tags_.assign(slots, kEmpty);
+            nodes_.assign(slots, nullptr);
+            size_ = deleted_ = 0;
+        }
+
+        void place(uint64_t hash, TNodePtr node)
+        {
+            size_t slot = hash & mask();
+            while (tags_[slot] > kDeleted) {
+                slot = (slot + 1) & mask();
+            }
+            deleted_ -= tags_[slot] == kDeleted;
+            tags_[slot] = tag_of(hash);
+            nodes_[slot] = node;
+        }
+
+        void rehash(size_t slots)
+        {
+            std::vector<TNodePtr> nodes;
+            nodes.reserve(size_);
+            for (auto node: nodes_) {
+                if (node) {
+                    nodes.push_back(node);
+                }
+            }
+            auto count = size_;
+            reset(slots);
+            for (auto node: nodes) {
+                place(mix_hash(THash()(node->key)), node);
+            }
+            size_ = count;
+        }
+    };
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+#include <utility>
+
+namespace stl
+{
+    template <typename TKey, typename = void>
+    struct is_hashable : std::false_type { };
+
+    template <typename TKey>
+    struct is_hashable<TKey, std::void_t<decltype(std::hash<TKey>()(std::declval<const TKey&>()))>>
+        : std::true_type { };
+
+    template <typename TKey>
+    inline constexpr bool is_hashable_v = is_hashable<TKey>::value;
+
+    // Finalizer of MurmurHash3. std::hash of integers and pointers is the
+    // identity, the hash tables and filters spread its bits with this before
+    // taking some of them.
+    inline uint64_t mix_hash(uint64_t hash)
+    {
+        hash ^= hash >> 33;
+        hash *= 0xff51afd7ed558ccdULL;
+        hash ^= hash >> 33;
+        hash *= 0xc4ceb9fe1a85ec53ULL;
+        hash ^= hash >> 33;
+        return hash;
+    }
+
+    // Equality in the order of the set, keys need not define operator==
+    template <typename TKey>
+    inline bool keys_equal(const TKey& left, const TKey& right)
+    {
+        return !(left < right) && !(right < left);
+    }
+}
@@ -1,10 +1,16 @@
 #pragma once
 
+#include <cstddef>
+#include <iterator>
+
 #include "base_entities.hpp"
 
 namespace stl
 {
-    template<typename Tp>
+    // Walks the keys of a tree in ascending order or, for Reverse, in descending
+    // order without the extra step std::reverse_iterator makes on every access.
+    // Threaded iterators follow the in-order links of ThreadedNode.
+    template<typename Tp, bool Threaded = false, bool Reverse = false>
     struct RedBlackTree_const_iterator
     {
         typedef std::bidirectional_iterator_tag iterator_category;
@@ -15,7 +21,7 @@ namespace stl
         typedef const Tp& reference;
 
         typedef Node<Tp>* _Base_ptr;
-        typedef RedBlackTree_const_iterator<Tp> _Self;
+        typedef RedBlackTree_const_iterator<Tp, Threaded, Reverse> _Self;
 
         _Base_ptr node;
 
@@ -32,6 +38,98 @@ namespace stl
             return &(node->key);
         }
 
+        _Self operator++()
+        {
+            node = Reverse ? prev(node) : next(node);
+            return *this;
+        }
+
+        _Self operator++(int)
+        {
+            _Self tmp = *this;
+            node = Reverse ? prev(node) : next(node);
+            return tmp;
+        }
+
+        _Self operator--()
+        {
+            node = Reverse ? next(node) : prev(node);
+            return *this;
+        }
+
+        _Self operator--(int)
+        {
+            _Self tmp = *this;
+            node = Reverse ? next(node) : prev(node);
+            return tmp;
+        }
+
+        friend bool operator==(const _Self& left, const _Self& right)
+        {
+            return left.node == right.node;
+        }
+
+        friend bool operator!=(const _Self& left, const _Self& right)
+        {
+            return left.node != right.node;
+        }
+
+     private:
+        static _Base_ptr next(_Base_ptr node)
+        {
+            if constexpr (Threaded) {
+                return static_cast<ThreadedNode<Node<Tp>>*>(node)->next;
+            } else {
+                return node->nextNode();
+            }
+        }
+
+        static _Base_ptr prev(_Base_ptr node)
+        {
+            if constexpr (Threaded) {
+                return static_cast<ThreadedNode<Node<Tp>>*>(node)->prev;
+            } else {
+                return node->prevNode();
+            }
+        }
+    };
+
+    // Iterator giving write access to the elements, used by containers whose
+    // elements have a part which is not compared, e.g. mapped values of Map
+    template<typename Tp>
+    struct RedBlackTree_iterator
+    {
+        typedef std::bidirectional_iterator_tag iterator_category;
+        typedef std::ptrdiff_t difference_type;
+
+        typedef Tp value_type;
+        typedef Tp* pointer;
+        typedef Tp& reference;
+
+        typedef Node<Tp>* _Base_ptr;
+        typedef RedBlackTree_iterator<Tp> _Self;
+
+        _Base_ptr node;
+
+        RedBlackTree_iterator() : node() {}
+        explicit RedBlackTree_iterator(const _Base_ptr other) : node(other) {}
+        explicit RedBlackTree_iterator(const RedBlackTree_const_iterator<Tp>& other) : node(other.node) {}
+
+        operator RedBlackTree_const_iterator<Tp>() const
+        {
+            return RedBlackTree_const_iterator<Tp>(node);
+        }
+
+        reference operator*() const
+        {
+            return node->key;
+        }
+
+        pointer operator->() const
+        {
+            return &(node->key);
+        }
+
         _Self operator++()
         {
             node = node->nextNode();
@@ -0,0 +1,182 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+#include "hashing.hpp"
+#include "relaxed_counter.hpp"
+
+namespace stl
+{
+    // Counters of a lookup cache placed in front of a container lookup
+    struct CacheStats
+    {
+        size_t memory_bytes = 0;
+        size_t capacity = 0;
+        size_t lookups = 0;        // lookups that consulted the cache
+        size_t hits = 0;           // lookups answered by the cache alone
+        size_t invalidations = 0;  // entries dropped because their keys left the container
+
+        double hit_rate() const
+        {
+            return lookups ? double(hits) / lookups : 0;
+        }
+    };
+
+    ///////////////////////////////////////////////////////////////////////////////
+    /// Template class LookupCache
+    ///////////////////////////////////////////////////////////////////////////////
+
+    // Set-associative cache from keys to the nodes holding them. A key hashes to a
+    // bucket of kWays entries in one cache line, a hit moves its entry a step
+    // towards the front of the bucket and a new entry evicts the last one, so keys
+    // looked up often stay cached. Entries keep the full hash, the key of a node
+    // is compared only when the hashes match.
+    //
+    // The cache does not own the nodes: the owner erases a key from the cache
+    // before its node leaves the container. A copy of a cache is empty, since its
+    // entries point to the nodes of another container.
+    //
+    // find() only reads the entries and may run in several threads at once, the
+    // counters it bumps are atomic. promote(), add() and erase() change the
+    // entries and need exclusive access, like updates of the container.
+
+    template <typename TKey, typename TNodePtr, typename THash = std::hash<TKey>>
+    class LookupCache
+    {
+     public:
+        static constexpr size_t kWays = 4;
+
+        explicit LookupCache(size_t capacity) : buckets_(buckets_count(capacity)), invalidations_(0) { }
+
+        LookupCache(const LookupCache& other) : buckets_(other.buckets_.size()), invalidations_(0) { }
+
+        LookupCache& operator=(const LookupCache& other)
+        {
+            if (&other != this) {
+                *this = LookupCache(other);
+            }
+            return *this;
+        }
+
+        LookupCache(LookupCache&&) = default;
+        LookupCache& operator=(LookupCache&&) = default;
+
+        // Node of key or nullptr if key is not cached
+        TNodePtr find(const TKey& key) const
+        {
+            auto hash = mix_hash(THash()(key));
+            auto way = way_of(bucket_of(hash), hash, key);
+            return way < kWays ? bucket_of(hash)[way].node : nullptr;
+        }
+
+        // find() which also moves a hit a step towards the front of its bucket
+        TNodePtr promote(const TKey& key)
+        {
+            auto hash = mix_hash(THash()(key));
+            auto& bucket = bucket_of(hash);
+            auto way = way_of(bucket, hash, key);
+            if (way == kWays) {
+                return nullptr;
+            }
+            if (way) {
+                std::swap(bucket[way], bucket[way - 1]);
+                way--;
+            }
+            return bucket[way].node;
+        }
+
+        // Caches a node found in the container, key must not be cached yet
+        void add(const TKey& key, TNodePtr node)
+        {
+            auto hash = mix_hash(THash()(key));
+            auto& bucket = bucket_of(hash);
+            for (size_t way(kWays - 1); way > 0; way--) {
+                bucket[way] = bucket[way - 1];
+            }
+            bucket[0] = Entry{hash, node};
+        }
+
+        void erase(const TKey& key)
+        {
+            auto hash = mix_hash(THash()(key));
+            auto& bucket = bucket_of(hash);
+            for (size_t way(0); way < kWays; way++) {
+                if (bucket[way].node && bucket[way].hash == hash && keys_equal(bucket[way].node->key, key)) {
+                    for (; way + 1 < kWays; way++) {
+                        bucket[way] = bucket[way + 1];
+                    }
+                    bucket[kWays - 1] = Entry();
+                    invalidations_++;
+                    return;
+                }
+            }
+        }
+
+        void clear()
+        {
+            buckets_.assign(buckets_.size(), Bucket());
+        }
+
+        CacheStats stats() const
+        {
+            CacheStats stats;
+            stats.capacity = buckets_.size() * kWays;
+            stats.memory_bytes = buckets_.size() * sizeof(Bucket);
+            stats.lookups = lookups_;
+            stats.hits = hits_;
+            stats.invalidations = invalidations_;
+            return stats;
+        }
+
+     private:
+        struct Entry
+        {
+            uint64_t hash = 0;
+            TNodePtr node = nullptr;
+        };
+
+        // a bucket fills one cache line with 8-byte hashes and pointers
+        struct alignas(kWays * sizeof(Entry)) Bucket : std::array<Entry, kWays> { };
+
+        std::vector<Bucket> buckets_;
+        mutable RelaxedCounter lookups_;
+        mutable RelaxedCounter hits_;
+        size_t invalidations_;
+
+        static size_t buckets_count(size_t capacity)
+        {
+            size_t count(1);
+            while (count * kWays < capacity) {
+                count *= 2;
+            }
+            return count;
+        }
+
+        Bucket& bucket_of(uint64_t hash)
+        {
+            return buckets_[hash & (buckets_.size() - 1)];
+        }
+
+        const Bucket& bucket_of(uint64_t hash) const
+        {
+            return buckets_[hash & (buckets_.size() - 1)];
+        }
+
+        // Way of bucket holding key or kWays, counts the lookup
+        size_t way_of(const Bucket& bucket, uint64_t hash, const TKey& key) const
+        {
+            ++lookups_;
+            for (size_t way(0); way < kWays; way++) {
+                if (bucket[way].node && bucket[way].hash == hash && keys_equal(bucket[way].node->key, key)) {
+                    ++hits_;
+                    return way;
+                }
+            }
+            return kWays;
+        }
+    };
+}
@@ -0,0 +1,227 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+namespace stl
+{
+    // Counters of the node storage of a tree
+    struct NodeStorageStats
+    {
+        size_t regions = 0;
+        size_t reserved_bytes = 0;       // address space of the regions
+        size_t huge_page_regions = 0;    // regions backed by huge pages on request
+        size_t explicit_huge_pages = 0;  // regions taken from hugetlbfs
+    };
+
+    // Node storage of HeapNodes, and of extracted nodes of every tree: a node
+    // handle may outlive its tree, so it owns a node of the heap
+    template <typename TNode>
+    class NodeHeap
+    {
+     public:
+        template <typename... Args>
+        static TNode* create(Args&&... args)
+        {
+            return new TNode(std::forward<Args>(args)...);
+        }
+
+        static void destroy(TNode* node)
+        {
+            delete node;
+        }
+
+        // Nodes are freed one by one
+        static constexpr bool kBulkRelease = false;
+
+        NodeStorageStats stats() const
+        {
+            return NodeStorageStats();
+        }
+    };
+
+    ///////////////////////////////////////////////////////////////////////////////
+    /// Template class NodeArena
+    ///////////////////////////////////////////////////////////////////////////////
+
+    // Node storage of HugePageNodes. Regions start at 2 MiB and double up to
+    // kMaxRegionSize, so small trees do not reserve much. A region is first asked
+    // from hugetlbfs (MAP_HUGETLB), which works only when the administrator has
+    // reserved huge pages; otherwise it is mapped 2 MiB aligned and given to
+    // transparent huge pages with madvise(MADV_HUGEPAGE). Systems without mmap
+    // get plain heap blocks. Freed nodes form a list threaded through their
+    // slots and are taken first by create().
+
+    template <typename TNode>
+    class NodeArena
+    {
+     public:
+        static constexpr size_t kHugePageSize = size_t(2) << 20;
+        static constexpr size_t kMaxRegionSize = size_t(256) << 20;
+
+        NodeArena() : free_(nullptr), next_(nullptr), left_(0), stats_() { }
+
+        NodeArena(const NodeArena&) = delete;
+        NodeArena& operator=(const NodeArena&) = delete;
+
+        ~NodeArena()
+        {
+            release();
+        }
+
+        template <typename... Args>
+        TNode* create(Args&&... args)
+        {
+            void* slot = take();
+            try {
+                return new (slot) TNode(std::forward<Args>(args)...);
+            } catch (...) {
+                give_back(slot);
+                throw;
+            }
+        }
+
+        void destroy(TNode* node)
+        {
+            node->~TNode();
+            give_back(node);
+        }
+
+        // Nodes without destructors to run are dropped with their regions
+        static constexpr bool kBulkRelease = std::is_trivially_destructible_v<TNode>;
+
+        // Returns all regions, the nodes in them must be destroyed or trivially
+        // destructible. O(regions).
+        void release()
+        {
+            for (auto& region: regions_) {
+                unmap(region);
+            }
+            regions_.clear();
+            free_ = nullptr;
+            next_ = nullptr;
+            left_ = 0;
+            stats_ = NodeStorageStats();
+        }
+
+        NodeStorageStats stats() const
+        {
+            return stats_;
+        }
+
+     private:
+        union Slot
+        {
+            Slot* next;
+            alignas(TNode) unsigned char node[sizeof(TNode)];
+        };
+
+        struct Region
+        {
+            char* data;
+            size_t size;
+            bool mapped;
+        };
+
+        std::vector<Region> regions_;
+        Slot* free_;
+        char* next_;
+        size_t left_;
+        NodeStorageStats stats_;
+
+        void* take()
+        {
+            if (free_) {
+                Slot* slot = free_;
+                free_ = slot->next;
+                return slot;
+            }
+            if (left_ < sizeof(Slot)) {
+                size_t size = regions_.empty() ? kHugePageSize : regions_.back().size * 2;
+                // room for the region first, so a mapped region is never lost
+                regions_.reserve(regions_.size() + 1);
+                Region region = map(size < kMaxRegionSize ? size : kMaxRegionSize);
+                regions_.push_back(region);
+                stats_.regions++;
+                stats_.reserved_bytes += region.size;
+                next_ = region.data, left_ = region.size;
+            }
+            void* slot = next_;
+            next_ += sizeof(Slot), left_ -= sizeof(Slot);
+            return slot;
+        }
+
+        void give_back(void* node)
+        {
+            Slot* slot = static_cast<Slot*>(node);
+            slot->next = free_;
+            free_ = slot;
+        }
+
+        Region map(size_t size)
+        {
+#ifdef __linux__
+#ifdef MAP_HUGETLB
+            // without MAP_NORESERVE: a mapping the pool cannot back fails here
+            // instead of raising SIGBUS on first touch
+            int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB;
+#ifdef MAP_HUGE_SHIFT
+            flags |= 21 << MAP_HUGE_SHIFT;
+#endif
+            void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, flags, -1, 0);
+            if (data != MAP_FAILED) {
+                stats_.explicit_huge_pages++;
+                return Region{static_cast<char*>(data), size, true};
+            }
+#endif
+            // over-reserve to cut a range aligned to the huge page size
+            size_t reserved = size + kHugePageSize;
+            void* raw = mmap(nullptr, reserved, PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+            if (raw == MAP_FAILED) {
+                throw std::bad_alloc();
+            }
+            char* begin = static_cast<char*>(raw);
+            char* aligned = reinterpret_cast<char*>(
+                (reinterpret_cast<uintptr_t>(begin) + kHugePageSize - 1) & ~(kHugePageSize - 1));
+            if (aligned != begin) {
+                munmap(begin, aligned - begin);
+            }
+            if (aligned + size != begin + reserved) {
+                munmap(aligned + size, begin + reserved - (aligned + size));
+            }
+#ifdef MADV_HUGEPAGE
+            if (!madvise(aligned, size, MADV_HUGEPAGE)) {
+                stats_.huge_page_regions++;
+            }
+#endif
+            return Region{aligned, size, true};
+#else
+            void* data = std::malloc(size);
+            if (!data) {
+                throw std::bad_alloc();
+            }
+            return Region{static_cast<char*>(data), size, false};
+#endif
+        }
+
+        static void unmap(const Region& region)
+        {
+#ifdef __linux__
+            if (region.mapped) {
+                munmap(region.data, region.size);
+                return;
+            }
+#endif
+            std::free(region.data);
+        }
+    };
+}
@@ -0,0 +1,243 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <iterator>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "Set.hpp"
+
+namespace stl
+{
+    namespace execution
+    {
+        // Execution policies of the set algorithms below. A parallel scan runs on
+        // threads threads, 0 means std::thread::hardware_concurrency().
+        struct sequenced_policy { };
+
+        struct parallel_policy
+        {
+            size_t threads = 0;
+        };
+
+        inline constexpr sequenced_policy seq{};
+        inline constexpr parallel_policy par{};
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    /// Template class TreePartition
+    ///////////////////////////////////////////////////////////////////////////////
+
+    // Key range of a set cut into pieces between the split points of the tree:
+    // the keys of the top kSplitDepth levels under the highest node of the range
+    // cut it into up to 2^kSplitDepth runs of whole subtrees. Subtrees hanging at
+    // one depth of a balanced tree may still differ in size severalfold, since
+    // nodes at one depth can have different numbers of black ancestors, so there
+    // are many more pieces than threads and the threads even out the load by
+    // taking pieces one by one from a shared counter. Treaps and splay trees are
+    // cut into runs of equal length instead, see RedBlackTree::split_points.
+    //
+    // The pieces depend only on the shape of the tree, so results combined piece
+    // by piece in key order are the same for any number of threads. Sets smaller
+    // than kMinParallelKeys are scanned by the calling thread alone.
+
+    template <typename TIterator>
+    class TreePartition
+    {
+     public:
+        static constexpr size_t kSplitDepth = 10;
+        static constexpr size_t kMinParallelKeys = 1 << 14;
+
+        template <typename TSet, typename TKey>
+        TreePartition(const TSet& set, const TKey& lo, const TKey& hi, Bounds bounds)
+            : parallel_(set.size() >= kMinParallelKeys)
+        {
+            std::vector<TIterator> points;
+            set.split_points(lo, hi, kSplitDepth, std::back_inserter(points), bounds);
+            auto range = set.range(lo, hi, bounds);
+            TIterator first = range.begin();
+            for (auto point: points) {
+                if (point != first) {
+                    pieces_.emplace_back(first, point);
+                    first = point;
+                }
+            }
+            if (first != range.end()) {
+                pieces_.emplace_back(first, range.end());
+            }
+        }
+
+        size_t size() const
+        {
+            return pieces_.size();
+        }
+
+        // Calls fn(index, first, last) for every non-empty piece, the calling thread
+        // takes part. The first exception thrown by fn is rethrown once all threads
+        // are joined, pieces not started by then are skipped.
+        template <typename TFunc>
+        void run(size_t threads, TFunc fn) const
+        {
+            if (!threads) {
+                threads = std::max(1u, std::thread::hardware_concurrency());
+            }
+            threads = parallel_ ? std::min(threads, pieces_.size()) : 1;
+
+            std::atomic<size_t> next(0);
+            std::exception_ptr error;
+            std::mutex error_mutex;
+            auto worker = [&]() {
+                try {
+                    for (size_t index; (index = next++) < pieces_.size(); ) {
+                        fn(index, pieces_[index].first, pieces_[index].second);
+                    }
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(error_mutex);
+                    if (!error) {
+                        error = std::current_exception();
+                    }
+                    next = pieces_.size();
+                }
+            };
+
+            std::vector<std::thread> pool;
+            for (size_t i(1); i < threads; i++) {
+                pool.emplace_back(worker);
+            }
+            worker();
+            for (auto& thread: pool) {
+                thread.join();
+            }
+            if (error) {
+                std::rethrow_exception(error);
+            }
+        }
+
+     private:
+        std::vector<std::pair<TIterator, TIterator>> pieces_;
+        bool parallel_;
+    };
+
+    // Calls fn for every key of the set, in ascending order with seq and
+    // concurrently from several threads with par
+    template <typename TKey, typename TTraits, typename TFunc>
+    void for_each(execution::sequenced_policy, const Set<TKey, TTraits>& set, TFunc fn)
+    {
+        for (const auto& key: set) {
+            fn(key);
+        }
+    }
+
+    template <typename TKey, typename TTraits, typename TFunc>
+    void for_each(execution::sequenced_policy,
+                  const Set<TKey, TTraits>& set,
+                  const typename Set<TKey, TTraits>::value_type& lo,
+                  const typename Set<TKey, TTraits>::value_type& hi,
+                  TFunc fn,
+                  Bounds bounds = Bounds::Closed)
+    {
+        set.for_each_range(lo, hi, fn, bounds);
+    }
+
+    template <typename TKey, typename TTraits, typename TFunc>
+    void for_each(execution::parallel_policy policy,
+                  const Set<TKey, TTraits>& set,
+                  const typename Set<TKey, TTraits>::value_type& lo,
+                  const typename Set<TKey, TTraits>::value_type& hi,
+                  TFunc fn,
+                  Bounds bounds = Bounds::Closed)
+    {
+        typedef typename Set<TKey, TTraits>::iterator iterator;
+        TreePartition<iterator> partition(set, lo, hi, bounds);
+        partition.run(policy.threads, [&](size_t, iterator first, iterator last) {
+            for (; first != last; ++first) {
+                fn(*first);
+            }
+        });
+    }
+
+    template <typename TKey, typename TTraits, typename TFunc>
+    void for_each(execution::parallel_policy policy, const Set<TKey, TTraits>& set, TFunc fn)
+    {
+        if (!set.empty()) {
+            for_each(policy, set, *set.begin(), *set.rbegin(), fn);
+        }
+    }
+
+    // Folds transform(key) over the keys in ascending order starting from init. The
+    // parallel version folds every piece of the tree separately and then the
+    // pieces in key order, so reduce must be associative but need not commute, and
+    // the result does not depend on the number of threads.
+    template <typename TKey, typename TTraits, typename T, typename TReduce, typename TTransform>
+    T transform_reduce(execution::sequenced_policy,
+                       const Set<TKey, TTraits>& set,
+                       T init,
+                       TReduce reduce,
+                       TTransform transform)
+    {
+        for (const auto& key: set) {
+            init = reduce(std::move(init), transform(key));
+        }
+        return init;
+    }
+
+    template <typename TKey, typename TTraits, typename T, typename TReduce, typename TTransform>
+    T transform_reduce(execution::sequenced_policy,
+                       const Set<TKey, TTraits>& set,
+                       const typename Set<TKey, TTraits>::value_type& lo,
+                       const typename Set<TKey, TTraits>::value_type& hi,
+                       T init,
+                       TReduce reduce,
+                       TTransform transform,
+                       Bounds bounds = Bounds::Closed)
+    {
+        set.for_each_range(lo, hi, [&](const TKey& key) {
+            init = reduce(std::move(init), transform(key));
+        }, bounds);
+        return init;
+    }
+
+    template <typename TKey, typename TTraits, typename T, typename TReduce, typename TTransform>
+    T transform_reduce(execution::parallel_policy policy,
+                       const Set<TKey, TTraits>& set,
+                       const typename Set<TKey, TTraits>::value_type& lo,
+                       const typename Set<TKey, TTraits>::value_type& hi,
+                       T init,
+                       TReduce reduce,
+                       TTransform transform,
+                       Bounds bounds = Bounds::Closed)
+    {
+        typedef typename Set<TKey, TTraits>::iterator iterator;
+        TreePartition<iterator> partition(set, lo, hi, bounds);
+        std::vector<std::optional<T>> partial(partition.size());
+        partition.run(policy.threads, [&](size_t index, iterator first, iterator last) {
+            T value(transform(*first));
+            for (++first; first != last; ++first) {
+                value = reduce(std::move(value), transform(*first));
+            }
+            partial[index] = std::move(value);
+        });
+        for (auto& value: partial) {
+            init = reduce(std::move(init), std::move(*value));
+        }
+        return init;
+    }
+
+    template <typename TKey, typename TTraits, typename T, typename TReduce, typename TTransform>
+    T transform_reduce(execution::parallel_policy policy,
+                       const Set<TKey, TTraits>& set,
+                       T init,
+                       TReduce reduce,
+                       TTransform transform)
+    {
+        if (set.empty()) {
+            return init;
+        }
+        return transform_reduce(policy, set, *set.begin(), *set.rbegin(),
+                                std::move(init), reduce, transform);
+    }
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <iterator>
+
+namespace stl
+{
+    // Which ends of a [lo, hi] key range belong to it
+    enum class Bounds { Closed, Open, LeftOpen, RightOpen };
+
+    inline bool is_left_closed(Bounds bounds)
+    {
+        return bounds == Bounds::Closed || bounds == Bounds::RightOpen;
+    }
+
+    inline bool is_right_closed(Bounds bounds)
+    {
+        return bounds == Bounds::Closed || bounds == Bounds::LeftOpen;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    /// Template class RangeView
+    ///////////////////////////////////////////////////////////////////////////////
+
+    // Non-owning pair of container iterators, usable in range-for and with
+    // reverse iteration. Holds no allocations and is invalidated like the
+    // iterators it is made of.
+
+    template <typename TIterator>
+    class RangeView
+    {
+        TIterator first_, last_;
+
+     public:
+        typedef TIterator iterator;
+        typedef std::reverse_iterator<iterator> reverse_iterator;
+        typedef typename std::iterator_traits<iterator>::value_type value_type;
+
+        RangeView(iterator first, iterator last) : first_(first), last_(last) { }
+
+        iterator begin() const
+        {
+            return first_;
+        }
+
+        iterator end() const
+        {
+            return last_;
+        }
+
+        reverse_iterator rbegin() const
+        {
+            return reverse_iterator(last_);
+        }
+
+        reverse_iterator rend() const
+        {
+            return reverse_iterator(first_);
+        }
+
+        bool empty() const
+        {
+            return first_ == last_;
+        }
+
+        // Linear in the length of the range
+        size_t size() const
+        {
+            return std::distance(first_, last_);
+        }
+    };
+}
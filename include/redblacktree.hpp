@@ -1,30 +1,54 @@
 #pragma once
 
+#include <algorithm>
+#include <cstdint>
 #include <iterator>
 #include <initializer_list>
+#include <type_traits>
 
 #include "base_entities.hpp"
+#include "hashing.hpp"
 #include "iterators.hpp"
+#include "node_arena.hpp"
+#include "range_view.hpp"
+#include "tree_traits.hpp"
 
 namespace stl
 {
+    // Nodes carry thread links and an aggregate only when the traits ask for them
+    template <typename TKey, typename TTraits>
+    struct tree_node
+    {
+        typedef typename TTraits::aggregate aggregate;
+        typedef std::conditional_t<TTraits::threaded, ThreadedNode<Node<TKey>>, Node<TKey>> threaded_type;
+        typedef std::conditional_t<std::is_same_v<aggregate, NoAggregate>,
+                                   threaded_type,
+                                   AggregateNode<threaded_type, typename aggregate::value_type>> type;
+    };
+
     ///////////////////////////////////////////////////////////////////////////////
     /// Template class RedBlackTree
     ///////////////////////////////////////////////////////////////////////////////
 
-    template <typename TKey>
+    template <typename TKey, typename TTraits = TreeTraits<TKey>>
     class RedBlackTree
     {
      public:
         typedef TKey value_type;
-        typedef RedBlackTree_const_iterator<value_type> iterator;
-        typedef std::reverse_iterator<iterator> reverse_iterator;
+        typedef typename TTraits::key_type key_type;
+        typedef RedBlackTree_const_iterator<value_type, TTraits::threaded> iterator;
+        typedef RedBlackTree_const_iterator<value_type, TTraits::threaded, true> reverse_iterator;
         typedef Node<TKey> _Base;
         typedef Node<TKey>* _Base_ptr;
+        typedef typename TTraits::aggregate aggregate_policy;
+        typedef typename tree_node<TKey, TTraits>::type node_type;
+        typedef typename aggregate_policy::value_type aggregate_type;
+        static constexpr bool kArena = std::is_same_v<typename TTraits::node_storage, HugePageNodes>;
+        typedef std::conditional_t<kArena, NodeArena<node_type>, NodeHeap<node_type>> storage_type;
 
      public:
         RedBlackTree();
-        RedBlackTree(const RedBlackTree<value_type>& other);
+        RedBlackTree(const RedBlackTree& other);
 
         template <class _InputIterator>
         RedBlackTree(_InputIterator first, _InputIterator last);
@@ -36,12 +60,50 @@ namespace stl
         void clear();
         inline void drop(_Base_ptr node);
         void insert(const value_type& val);
-        void erase(const value_type& val);
+        iterator insert(iterator hint, const value_type& val);
+
+        template <typename... Args>
+        std::pair<_Base_ptr, bool> try_emplace(const key_type& key, Args&&... args);
+        void erase(const key_type& val);
+        iterator erase(iterator pos);
+        iterator erase(iterator first, iterator last);
+
+        class node_handle;
+        struct insert_return_type;
+
+        node_handle extract(iterator pos);
+        node_handle extract(const key_type& key);
+        insert_return_type insert(node_handle&& handle);
+        void merge(RedBlackTree& other);
+
+        std::pair<_Base_ptr, bool> contains(const key_type& key) const;
+        iterator find(const key_type& val) const;
+        iterator lower_bound(const key_type& val) const;
+        iterator upper_bound(const key_type& val) const;
+        iterator seek(iterator from, const key_type& val) const;
+        std::pair<iterator, iterator> equal_range(const key_type& key) const;
+        size_t count(const key_type& key) const;
+        RangeView<iterator> range(const key_type& lo, const key_type& hi, Bounds bounds) const;
+        aggregate_type aggregate(const key_type& lo, const key_type& hi, Bounds bounds) const;
+
+        template <typename TFunc>
+        void for_each_range(const key_type& lo, const key_type& hi, Bounds bounds, TFunc fn) const;
+
+        template <class _OutputIterator>
+        _OutputIterator split_points(const key_type& lo,
+                                     const key_type& hi,
+                                     Bounds bounds,
+                                     size_t depth,
+                                     _OutputIterator out) const;
+
+        template <class _ForwardIterator, class _OutputIterator>
+        _OutputIterator find_many(_ForwardIterator first, _ForwardIterator last, _OutputIterator out) const;
+
+        template <class _ForwardIterator, class _OutputIterator>
+        _OutputIterator lower_bound_many(_ForwardIterator first,
+                                         _ForwardIterator last,
+                                         _OutputIterator out) const;
 
-        std::pair<_Base_ptr, bool> contains(const value_type& key) const;
-        iterator find(const value_type& val) const;
-        iterator lower_bound(const value_type& val) const;
-        iterator upper_bound(const value_type& val) const;
         iterator begin() const;
         iterator end() const;
         reverse_iterator rbegin() const;
@@ -51,21 +113,87 @@ namespace stl
         _Base_ptr root() const;
         _Base_ptr leftmost() const;
         _Base_ptr rightmost() const;
+        NodeStorageStats node_storage_stats() const;
 
         static _Base_ptr minimum(_Base_ptr node);
         static _Base_ptr maximum(_Base_ptr node);
 
-        RedBlackTree<value_type>& operator=(const RedBlackTree<value_type>& other);
+        RedBlackTree& operator=(const RedBlackTree& other);
 
      private:
-        RedBlackTreeHeader<value_type> header_;
+        // number of lookups whose descents are interleaved by *_many methods
+        static constexpr size_t kLookupGroup = 16;
+        // red-black tree height never exceeds 2 * log2(n + 1), AVL tree height is lower
+        static constexpr size_t kMaxHeight = 2 * 64;
+        static constexpr bool kCopyKeysOnErase = copy_keys_on_erase_v<TKey, TTraits>;
+        static constexpr bool kAggregate = !std::is_same_v<aggregate_policy, NoAggregate>;
+        // nodes keep a summary of their subtree, updated by Balancer::update
+        static constexpr bool kAugmented = TTraits::augmented || kAggregate;
+        static constexpr bool kAvl = std::is_same_v<typename TTraits::rebalance, AvlRebalance>;
+        static constexpr bool kTreap = std::is_same_v<typename TTraits::rebalance, TreapRebalance>;
+        static constexpr bool kSplay = std::is_same_v<typename TTraits::rebalance, SplayRebalance>;
+        // treaps and splay trees have no worst-case bound of the height
+        static constexpr bool kBoundedHeight = !kTreap && !kSplay;
+
+        // mutable: a splay tree moves found keys to the root in const lookups
+        mutable RedBlackTreeHeader<value_type, node_type> header_;
+        storage_type storage_;
+
+        static const key_type& key_of(const _Base_ptr node)
+        {
+            return TTraits::key_of(node->key);
+        }
+
+        // Descents choose the next child with a conditional move, so the CPU does
+        // not speculate down the tree and load the next level early. Asking for both
+        // children while the key of the node is compared keeps those loads
+        // overlapped; prefetching a null child is a no-op.
+        static void prefetch_children(const _Base_ptr node)
+        {
+            __builtin_prefetch(node->child[Left]);
+            __builtin_prefetch(node->child[Right]);
+        }
+
+        template <typename... Args>
+        _Base_ptr create_node(Args&&... args)
+        {
+            return storage_.create(std::forward<Args>(args)...);
+        }
+
+        void delete_node(_Base_ptr node)
+        {
+            storage_.destroy(static_cast<node_type*>(node));
+        }
+
+        static aggregate_type summary_of(const _Base_ptr node)
+        {
+            return node ? static_cast<const node_type*>(node)->summary : aggregate_policy::identity();
+        }
+
+        void link(_Base_ptr parent, _Base_ptr node);
+        void unlink(_Base_ptr node);
+        _Base_ptr equal_parent(const key_type& key) const;
+        std::pair<_Base_ptr, iterator> extract_node(iterator pos);
+        _Base_ptr adopt(_Base_ptr node, storage_type& from);
+        void destroy(_Base_ptr node);
+
+        template <class _ForwardIterator, class _OutputIterator, typename TStep>
+        _OutputIterator descend_many(_ForwardIterator first,
+                                     _ForwardIterator last,
+                                     _OutputIterator out,
+                                     const TStep& step) const;
 
      private:
         class Balancer
         {
-            static _Base_ptr lrotate(_Base_ptr node);
-            static _Base_ptr rrotate(_Base_ptr node);
+            static _Base_ptr rotate(_Base_ptr node, bool dir);
+            static inline _Base_ptr rotate_up(_Base_ptr node);
             static inline bool is_black(_Base_ptr node);
+            static inline int height(_Base_ptr node);
+            static inline void fix_height(_Base_ptr node);
+            static _Base_ptr avl_balance(_Base_ptr node);
+            static void avl_retrace(_Base_ptr node, _Base& header_data);
+            static inline uint64_t priority(_Base_ptr node);
 
             static inline void relink_parent(_Base_ptr& parent,
                                              _Base_ptr& prev,
@@ -73,55 +201,152 @@ namespace stl
                                              bool prev_is_root = false);
 
             static void swap(_Base_ptr& node, _Base_ptr& other);
+            static void attach(_Base_ptr node, _Base_ptr parent, _Base& header_data);
+            static void detach(_Base_ptr node, _Base& header_data);
+            static _Base_ptr splice(_Base_ptr node, _Base& header_data);
 
          public:
+            static inline ThreadedNode<_Base>* threads(_Base_ptr node);
+            static void thread(_Base_ptr node, _Base_ptr prev, _Base_ptr next);
+            static void unthread(_Base_ptr node);
+            static inline void update(_Base_ptr node);
+            static void update_path(_Base_ptr node, _Base& header_data);
+            static void splay(_Base_ptr node);
+
             static _Base_ptr insert_and_rebalance(_Base_ptr node,
                                                   _Base_ptr parent,
                                                   _Base& header_data);
 
-            static void erase_and_rebalance(_Base_ptr node, _Base& header_data);
+            static _Base_ptr erase_and_rebalance(_Base_ptr node, _Base& header_data);
+
+            static _Base_ptr insert_top_down(const value_type& val,
+                                             _Base& header_data,
+                                             storage_type& storage);
+            static _Base_ptr erase_top_down(const key_type& val, _Base& header_data);
         };
     };
 
 
+    ///////////////////////////////////////////////////////////////////////////////
+    /// Class RedBlackTree::node_handle
+    ///////////////////////////////////////////////////////////////////////////////
+
+    // Owns a node extracted from a tree. The node can be inserted into another
+    // tree of the same type without reallocation, its key can be changed before.
+    // The node is always a heap node and the handle may outlive its tree: with
+    // HugePageNodes extract moves the key out of the arena, and insert moves it
+    // into a node of the receiving arena.
+
+    template <typename TKey, typename TTraits>
+    class RedBlackTree<TKey, TTraits>::node_handle
+    {
+        friend class RedBlackTree;
+
+        typedef NodeHeap<node_type> heap_type;
+
+        _Base_ptr node_;
+
+        explicit node_handle(_Base_ptr node) : node_(node) { }
+
+        _Base_ptr release()
+        {
+            auto node = node_;
+            node_ = nullptr;
+            return node;
+        }
+
+     public:
+        node_handle() : node_(nullptr) { }
+
+        node_handle(node_handle&& other) noexcept : node_(other.release()) { }
+
+        node_handle& operator=(node_handle&& other) noexcept
+        {
+            if (&other != this) {
+                reset();
+                node_ = other.release();
+            }
+            return *this;
+        }
+
+        node_handle(const node_handle&) = delete;
+        node_handle& operator=(const node_handle&) = delete;
+
+        ~node_handle()
+        {
+            reset();
+        }
+
+        bool empty() const
+        {
+            return !node_;
+        }
+
+        explicit operator bool() const
+        {
+            return node_;
+        }
+
+        value_type& value() const
+        {
+            return node_->key;
+        }
+
+        void reset()
+        {
+            if (node_) {
+                heap_type::destroy(static_cast<node_type*>(release()));
+            }
+        }
+    };
+
+    template <typename TKey, typename TTraits>
+    struct RedBlackTree<TKey, TTraits>::insert_return_type
+    {
+        iterator position;
+        bool inserted;
+        node_handle node;
+    };
+
+
     ///////////////////////////////////////////////////////////////////////////////
     /// Implementation of template class RedBlackTree
     ///////////////////////////////////////////////////////////////////////////////
 
-    template <typename TKey>
-    RedBlackTree<TKey>::RedBlackTree() : header_() { }
+    template <typename TKey, typename TTraits>
+    RedBlackTree<TKey, TTraits>::RedBlackTree() : header_() { }
 
-    template <typename TKey>
-    RedBlackTree<TKey>::RedBlackTree(const RedBlackTree<value_type>& other) : RedBlackTree()
+    template <typename TKey, typename TTraits>
+    RedBlackTree<TKey, TTraits>::RedBlackTree(const RedBlackTree& other) : RedBlackTree()
     {
         for (const auto& val: other) {
             this->insert(val);
         }
     }
 
-    template<typename TKey>
+    template <typename TKey, typename TTraits>
     template <class _InputIterator>
-    RedBlackTree<TKey>::RedBlackTree(_InputIterator first,
-                                     _InputIterator last)
-                                     : RedBlackTree<TKey>::RedBlackTree()
+    RedBlackTree<TKey, TTraits>::RedBlackTree(_InputIterator first,
+                                              _InputIterator last)
+                                              : RedBlackTree()
     {
         for (auto iter(first); iter != last; iter++) {
             insert(*iter);
         }
     }
 
-    template<typename TKey>
-    RedBlackTree<TKey>::RedBlackTree(const std::initializer_list<value_type>& l)
-                                     : RedBlackTree(l.begin(), l.end()) { }
+    template <typename TKey, typename TTraits>
+    RedBlackTree<TKey, TTraits>::RedBlackTree(const std::initializer_list<value_type>& l)
+                                              : RedBlackTree(l.begin(), l.end()) { }
 
-    template<typename TKey>
-    RedBlackTree<TKey>::~RedBlackTree()
+    template <typename TKey, typename TTraits>
+    RedBlackTree<TKey, TTraits>::~RedBlackTree()
     {
         clear();
     }
 
-    template<typename TKey>
-    RedBlackTree<TKey>& RedBlackTree<TKey>::operator=(const RedBlackTree<value_type>& other)
+    template <typename TKey, typename TTraits>
+    RedBlackTree<TKey, TTraits>& RedBlackTree<TKey, TTraits>::operator=(const RedBlackTree& other)
     {
         if (&other != this) {
             this->clear();
@@ -132,194 +357,817 @@ namespace stl
         return *this;
     }
 
-    template<typename TKey>
-    void RedBlackTree<TKey>::clear()
+    template <typename TKey, typename TTraits>
+    void RedBlackTree<TKey, TTraits>::clear()
     {
-        auto node = header_.data.parent;
-        while (node && node != end().node) {
-            if (node->lchild) {
-                node = node->lchild;
-            } else if (node->rchild) {
-                node = node->rchild;
-            } else {
-                auto tmp = node->parent;
-                drop(node);
-                node = tmp;
+        if constexpr (storage_type::kBulkRelease) {
+            // nothing to destruct and extracted nodes live on the heap: drop the
+            // regions at once
+            storage_.release();
+        } else {
+            destroy(header_.data.parent);
+        }
+        header_.reset();
+    }
+
+    // Frees the whole subtree in a single post-order pass. Nothing is written to the
+    // nodes being freed: right subtrees are handled recursively (no deeper than the
+    // tree height) and the left spine iteratively.
+    // Trees without a height bound may be long paths, their left children are
+    // rotated up instead of recursing.
+    template <typename TKey, typename TTraits>
+    void RedBlackTree<TKey, TTraits>::destroy(_Base_ptr node)
+    {
+        if constexpr (!kBoundedHeight) {
+            while (node) {
+                if (auto lchild = node->child[Left]) {
+                    node->child[Left] = lchild->child[Right];
+                    lchild->child[Right] = node;
+                    node = lchild;
+                } else {
+                    auto rchild = node->child[Right];
+                    delete_node(node);
+                    node = rchild;
+                }
             }
+            return;
+        }
+        while (node) {
+            destroy(node->child[Right]);
+            auto lchild = node->child[Left];
+            delete_node(node);
+            node = lchild;
         }
     }
 
-    template<typename TKey>
-    void RedBlackTree<TKey>::drop(_Base_ptr node)
+    template <typename TKey, typename TTraits>
+    void RedBlackTree<TKey, TTraits>::drop(_Base_ptr node)
+    {
+        unlink(node);
+        delete_node(node);
+    }
+
+    // Removes a leaf left behind by Balancer::erase_and_rebalance, the node is
+    // not freed
+    template <typename TKey, typename TTraits>
+    void RedBlackTree<TKey, TTraits>::unlink(_Base_ptr node)
     {
         header_.nodes_count--;
         if (node->parent != end().node) {
             if (node->parent->is_lchild(node)) {
-                node->parent->lchild = nullptr;
+                node->parent->child[Left] = nullptr;
             } else if (node->parent->is_rchild(node)) {
-                node->parent->rchild = nullptr;
+                node->parent->child[Right] = nullptr;
+            }
+            if constexpr (kAugmented) {
+                Balancer::update_path(node->parent, header_.data);
             }
         } else {
-            header_.data.rchild = header_.data.lchild = &header_.data;
+            header_.data.child[Right] = header_.data.child[Left] = &header_.data;
             header_.data.parent = nullptr;
         }
-        delete node;
+        if constexpr (TTraits::threaded) {
+            Balancer::unthread(node);
+        }
+        // a phantom may still point to the child which took its place
+        node->parent = node->child[Left] = node->child[Right] = nullptr;
+        node->repaint(Color::Red);
     }
 
-    template<typename TKey>
-    void RedBlackTree<TKey>::insert(const value_type& val)
+    template <typename TKey, typename TTraits>
+    void RedBlackTree<TKey, TTraits>::insert(const value_type& val)
     {
-        auto [node, is_exist] = contains(val);
-        if (!is_exist) {
-            if (node) {
-                auto child = new Node(val);
-                Balancer::insert_and_rebalance(child, node, header_.data);
-            } else {
-                node = new Node(val, Color::Black);
-                node->parent = &header_.data;
-                header_.data.rchild = header_.data.lchild = node;
-                header_.data.parent = node;
+        if constexpr (!TTraits::unique_keys) {
+            link(equal_parent(TTraits::key_of(val)), create_node(val));
+            return;
+        } else if constexpr (std::is_same_v<typename TTraits::rebalance, TopDownRebalance>) {
+            if (header_.data.parent) {
+                if (Balancer::insert_top_down(val, header_.data, storage_)) {
+                    header_.nodes_count++;
+                }
+                return;
             }
-            header_.nodes_count++;
+        }
+        auto [node, is_exist] = contains(TTraits::key_of(val));
+        if (!is_exist) {
+            link(node, create_node(val));
         }
     }
 
-    template<typename TKey>
-    void RedBlackTree<TKey>::erase(const value_type& val)
+    // Constructs an element from args only if key is absent. Returns the node
+    // holding key and whether it was created.
+    template <typename TKey, typename TTraits>
+    template <typename... Args>
+    std::pair<typename RedBlackTree<TKey, TTraits>::_Base_ptr, bool>
+    RedBlackTree<TKey, TTraits>::try_emplace(const key_type& key, Args&&... args)
     {
+        auto [node, is_exist] = contains(key);
+        if (is_exist) {
+            return {node, false};
+        }
+        auto created = create_node(std::in_place, std::forward<Args>(args)...);
+        link(node, created);
+        return {created, true};
+    }
+
+    // Inserts val next to the lower bound found by seek() from hint, so nothing
+    // is descended from the root when val belongs close to hint.
+    template <typename TKey, typename TTraits>
+    typename RedBlackTree<TKey, TTraits>::iterator
+    RedBlackTree<TKey, TTraits>::insert(iterator hint, const value_type& val)
+    {
+        auto pos = seek(hint, TTraits::key_of(val)).node;
+        if (pos != end().node && !(TTraits::key_of(val) < key_of(pos))) {
+            return iterator(pos);
+        }
+
+        _Base_ptr parent(nullptr);
+        if (pos == end().node) {
+            parent = empty() ? nullptr : rightmost();
+        } else if (!pos->child[Left]) {
+            parent = pos;
+        } else {
+            parent = maximum(pos->child[Left]);
+        }
+        auto node = create_node(val);
+        link(parent, node);
+        return iterator(node);
+    }
+
+    template <typename TKey, typename TTraits>
+    void RedBlackTree<TKey, TTraits>::erase(const key_type& val)
+    {
+        if constexpr (!TTraits::unique_keys) {
+            auto [first, last] = equal_range(val);
+            erase(first, last);
+            return;
+        } else if constexpr (std::is_same_v<typename TTraits::rebalance, TopDownRebalance>) {
+            if (auto node = Balancer::erase_top_down(val, header_.data)) {
+                header_.nodes_count--;
+                delete_node(node);
+            }
+            return;
+        }
         auto [node, is_exist] = contains(val);
         if (is_exist) {
-            Balancer::erase_and_rebalance(node, header_.data);
-            drop(node);
+            drop(Balancer::erase_and_rebalance(node, header_.data));
         }
     }
 
-    template<typename TKey>
-    std::pair<typename RedBlackTree<TKey>::_Base_ptr, bool>
-    RedBlackTree<TKey>::contains(const value_type& key) const
+    template <typename TKey, typename TTraits>
+    typename RedBlackTree<TKey, TTraits>::iterator RedBlackTree<TKey, TTraits>::erase(iterator pos)
+    {
+        auto next = pos.node->nextNode();
+        auto removed = Balancer::erase_and_rebalance(pos.node, header_.data);
+        if (removed != pos.node) {
+            // the node of pos took the key of next
+            next = pos.node;
+        }
+        drop(removed);
+        return iterator(next);
+    }
+
+    // Erases [first, last) without descending from the root for every key. Keys
+    // are counted first: erasing may free the node of last when keys are copied.
+    template <typename TKey, typename TTraits>
+    typename RedBlackTree<TKey, TTraits>::iterator
+    RedBlackTree<TKey, TTraits>::erase(iterator first, iterator last)
+    {
+        if (first == begin() && last == end()) {
+            clear();
+            return end();
+        }
+        for (auto count = std::distance(first, last); count > 0; count--) {
+            first = erase(first);
+        }
+        return first;
+    }
+
+    // Parent of a new node with key when equal keys are allowed: equal keys go
+    // right, i.e. after the ones inserted earlier
+    template <typename TKey, typename TTraits>
+    typename RedBlackTree<TKey, TTraits>::_Base_ptr
+    RedBlackTree<TKey, TTraits>::equal_parent(const key_type& key) const
+    {
+        _Base_ptr parent(nullptr), node(header_.data.parent);
+        while (node) {
+            parent = node;
+            node = node->child[!(key < key_of(node))];
+        }
+        return parent;
+    }
+
+    // Unlinks the node of pos and returns it with an iterator to the next key
+    template <typename TKey, typename TTraits>
+    std::pair<typename RedBlackTree<TKey, TTraits>::_Base_ptr, typename RedBlackTree<TKey, TTraits>::iterator>
+    RedBlackTree<TKey, TTraits>::extract_node(iterator pos)
+    {
+        auto next = pos.node->nextNode();
+        if constexpr (kCopyKeysOnErase) {
+            value_type key = pos.node->key;
+            auto removed = Balancer::erase_and_rebalance(pos.node, header_.data);
+            if (removed != pos.node) {
+                // the node of pos took the key of next, the key of pos leaves in the freed node
+                next = pos.node;
+                removed->key = key;
+            }
+            unlink(removed);
+            return { removed, iterator(next) };
+        } else {
+            auto removed = Balancer::erase_and_rebalance(pos.node, header_.data);
+            unlink(removed);
+            return { removed, iterator(next) };
+        }
+    }
+
+    template <typename TKey, typename TTraits>
+    typename RedBlackTree<TKey, TTraits>::node_handle
+    RedBlackTree<TKey, TTraits>::extract(iterator pos)
+    {
+        auto node = extract_node(pos).first;
+        if constexpr (kArena) {
+            try {
+                auto heap_node = node_handle::heap_type::create(std::in_place, std::move(node->key));
+                delete_node(node);
+                node = heap_node;
+            } catch (...) {
+                delete_node(node);
+                throw;
+            }
+        }
+        return node_handle(node);
+    }
+
+    template <typename TKey, typename TTraits>
+    typename RedBlackTree<TKey, TTraits>::node_handle
+    RedBlackTree<TKey, TTraits>::extract(const key_type& key)
+    {
+        auto [node, is_exist] = contains(key);
+        return is_exist ? extract(iterator(node)) : node_handle();
+    }
+
+    // Links the node of handle into the tree unless its key is present, no
+    // allocation and no copy of the key unless the tree keeps its nodes in an arena
+    template <typename TKey, typename TTraits>
+    typename RedBlackTree<TKey, TTraits>::insert_return_type
+    RedBlackTree<TKey, TTraits>::insert(node_handle&& handle)
+    {
+        if (handle.empty()) {
+            return { end(), false, node_handle() };
+        }
+        _Base_ptr parent(nullptr);
+        if constexpr (TTraits::unique_keys) {
+            auto [node, is_exist] = contains(key_of(handle.node_));
+            if (is_exist) {
+                return { iterator(node), false, std::move(handle) };
+            }
+            parent = node;
+        } else {
+            parent = equal_parent(key_of(handle.node_));
+        }
+        _Base_ptr node;
+        if constexpr (kArena) {
+            node = create_node(std::in_place, std::move(handle.value()));
+            handle.reset();
+        } else {
+            node = handle.release();
+        }
+        link(parent, node);
+        return { iterator(node), true, node_handle() };
+    }
+
+    // Moves the nodes of other whose keys are absent here, the nodes are relinked
+    // and neither freed nor allocated, except for arenas, see adopt()
+    template <typename TKey, typename TTraits>
+    void RedBlackTree<TKey, TTraits>::merge(RedBlackTree& other)
+    {
+        if (&other == this) {
+            return;
+        }
+        for (auto it = other.begin(); it != other.end(); ) {
+            _Base_ptr parent(nullptr);
+            if constexpr (TTraits::unique_keys) {
+                auto [node, is_exist] = contains(key_of(it.node));
+                if (is_exist) {
+                    ++it;
+                    continue;
+                }
+                parent = node;
+            } else {
+                parent = equal_parent(key_of(it.node));
+            }
+            auto [node, next] = other.extract_node(it);
+            link(parent, adopt(node, other.storage_));
+            it = next;
+        }
+    }
+
+    // Node of this tree for an unlinked node from storage from. Heap nodes are
+    // taken as they are; a node of another arena is replaced with a node of this
+    // one holding its key, so every node is freed by the arena which made it.
+    template <typename TKey, typename TTraits>
+    typename RedBlackTree<TKey, TTraits>::_Base_ptr
+    RedBlackTree<TKey, TTraits>::adopt(_Base_ptr node, storage_type& from)
+    {
+        if constexpr (kArena) {
+            if (&from != &storage_) {
+                auto copy = create_node(std::in_place, std::move(node->key));
+                from.destroy(static_cast<node_type*>(node));
+                return copy;
+            }
+        }
+        return node;
+    }
+
+    // Attaches a new node as a child of parent, parent is null for an empty tree
+    template <typename TKey, typename TTraits>
+    void RedBlackTree<TKey, TTraits>::link(_Base_ptr parent, _Base_ptr node)
+    {
+        if (parent) {
+            Balancer::insert_and_rebalance(node, parent, header_.data);
+        } else {
+            node->repaint(Color::Black);
+            if constexpr (kAugmented) {
+                Balancer::update(node);
+            }
+            node->parent = &header_.data;
+            header_.data.child[Right] = header_.data.child[Left] = node;
+            header_.data.parent = node;
+            if constexpr (TTraits::threaded) {
+                Balancer::thread(node, &header_.data, &header_.data);
+            }
+        }
+        header_.nodes_count++;
+    }
+
+    template <typename TKey, typename TTraits>
+    std::pair<typename RedBlackTree<TKey, TTraits>::_Base_ptr, bool>
+    RedBlackTree<TKey, TTraits>::contains(const key_type& key) const
     {
         _Base_ptr curr_it(header_.data.parent), prev_it(nullptr);
         while (curr_it) {
+            prefetch_children(curr_it);
             prev_it = curr_it;
-            if (key < curr_it->key) {
-                curr_it = curr_it->lchild;
-            } else if (curr_it->key < key) {
-                curr_it = curr_it->rchild;
-            } else {
+            int order = compare_keys<TTraits>(key, key_of(curr_it));
+            if (!order) {
                 return { curr_it, true };
             }
+            curr_it = curr_it->child[order > 0];
         }
         return { prev_it, false };
     }
 
-    template<typename TKey>
-    typename RedBlackTree<TKey>::iterator RedBlackTree<TKey>::find(const value_type& val) const
+    template <typename TKey, typename TTraits>
+    typename RedBlackTree<TKey, TTraits>::iterator
+    RedBlackTree<TKey, TTraits>::find(const key_type& val) const
     {
         auto [node, is_exist] = contains(val);
         if (is_exist) {
+            if constexpr (kSplay) {
+                Balancer::splay(node);
+            }
             return iterator(node);
         }
         return end();
     }
 
-    template<typename TKey>
-    typename RedBlackTree<TKey>::iterator RedBlackTree<TKey>::lower_bound(const value_type& val) const
+    template <typename TKey, typename TTraits>
+    typename RedBlackTree<TKey, TTraits>::iterator
+    RedBlackTree<TKey, TTraits>::lower_bound(const key_type& val) const
     {
         _Base_ptr curr_it = header_.data.parent;
-        _Base_ptr result = const_cast<Node<value_type>*>(&header_.data);
+        _Base_ptr result = end().node;
         while (curr_it) {
-            if (!(curr_it->key < val)) {
-                result = curr_it, curr_it = curr_it->lchild;
-            } else {
-                curr_it = curr_it->rchild;
-            }
+            prefetch_children(curr_it);
+            bool right = key_of(curr_it) < val;
+            result = right ? result : curr_it;
+            curr_it = curr_it->child[right];
         }
         return iterator(result);
     }
 
-    template<typename TKey>
-    typename RedBlackTree<TKey>::iterator RedBlackTree<TKey>::upper_bound(const value_type& val) const
+    template <typename TKey, typename TTraits>
+    typename RedBlackTree<TKey, TTraits>::iterator
+    RedBlackTree<TKey, TTraits>::upper_bound(const key_type& val) const
     {
         _Base_ptr curr_it = header_.data.parent;
-        _Base_ptr result = const_cast<Node<value_type>*>(&header_.data);
+        _Base_ptr result = end().node;
         while (curr_it) {
-            if (val < curr_it->key) {
-                result = curr_it, curr_it = curr_it->lchild;
+            prefetch_children(curr_it);
+            bool right = !(val < key_of(curr_it));
+            result = right ? result : curr_it;
+            curr_it = curr_it->child[right];
+        }
+        return iterator(result);
+    }
+
+    // Descends together while lower and upper bounds share the path, then splits
+    template <typename TKey, typename TTraits>
+    std::pair<typename RedBlackTree<TKey, TTraits>::iterator, typename RedBlackTree<TKey, TTraits>::iterator>
+    RedBlackTree<TKey, TTraits>::equal_range(const key_type& key) const
+    {
+        _Base_ptr node = header_.data.parent;
+        _Base_ptr upper = end().node;
+        while (node) {
+            prefetch_children(node);
+            int order = compare_keys<TTraits>(key, key_of(node));
+            if (order < 0) {
+                upper = node, node = node->child[Left];
+            } else if (order > 0) {
+                node = node->child[Right];
             } else {
-                curr_it = curr_it->rchild;
+                _Base_ptr lower(node), curr_it(node->child[Left]);
+                while (curr_it) {
+                    prefetch_children(curr_it);
+                    bool right = key_of(curr_it) < key;
+                    lower = right ? lower : curr_it;
+                    curr_it = curr_it->child[right];
+                }
+                curr_it = node->child[Right];
+                while (curr_it) {
+                    prefetch_children(curr_it);
+                    bool right = !(key < key_of(curr_it));
+                    upper = right ? upper : curr_it;
+                    curr_it = curr_it->child[right];
+                }
+                return { iterator(lower), iterator(upper) };
             }
         }
+        return { iterator(upper), iterator(upper) };
+    }
+
+    // O(log n) for unique keys, O(log n + k) for k equal keys otherwise
+    template <typename TKey, typename TTraits>
+    size_t RedBlackTree<TKey, TTraits>::count(const key_type& key) const
+    {
+        if constexpr (TTraits::unique_keys) {
+            return contains(key).second;
+        } else {
+            auto [first, last] = equal_range(key);
+            return std::distance(first, last);
+        }
+    }
+
+    // Finger search: returns lower_bound(val) starting from the node of from instead
+    // of the root. It climbs parent links only until the subtree under the current
+    // node is known to hold the answer and descends from there, which costs
+    // O(log d) for a target d positions away from from.
+    template <typename TKey, typename TTraits>
+    typename RedBlackTree<TKey, TTraits>::iterator
+    RedBlackTree<TKey, TTraits>::seek(iterator from, const key_type& val) const
+    {
+        _Base_ptr node = from.node, result = end().node;
+        if (node == end().node) {
+            if (empty() || key_of(rightmost()) < val) {
+                return end();
+            }
+            node = rightmost();
+        }
+
+        if (key_of(node) < val) {
+            while (!is_root(node)) {
+                _Base_ptr parent = node->parent;
+                if (parent->is_lchild(node) && !(key_of(parent) < val)) {
+                    result = parent;
+                    break;
+                }
+                node = parent;
+            }
+        } else {
+            result = node;
+            while (!is_root(node)) {
+                _Base_ptr parent = node->parent;
+                if (parent->is_rchild(node) && key_of(parent) < val) {
+                    break;
+                }
+                node = parent;
+            }
+        }
+
+        while (node) {
+            prefetch_children(node);
+            bool right = key_of(node) < val;
+            result = right ? result : node;
+            node = node->child[right];
+        }
         return iterator(result);
     }
 
-    template<typename TKey>
-    typename RedBlackTree<TKey>::iterator RedBlackTree<TKey>::begin() const
+    template <typename TKey, typename TTraits>
+    RangeView<typename RedBlackTree<TKey, TTraits>::iterator>
+    RedBlackTree<TKey, TTraits>::range(const key_type& lo, const key_type& hi, Bounds bounds) const
+    {
+        if (hi < lo || (!(lo < hi) && bounds != Bounds::Closed)) {
+            return RangeView<iterator>(end(), end());
+        }
+        return RangeView<iterator>(is_left_closed(bounds) ? lower_bound(lo) : upper_bound(lo),
+                                   is_right_closed(bounds) ? upper_bound(hi) : lower_bound(hi));
+    }
+
+    // Splits the search at the highest node inside the range, then takes whole
+    // subtrees hanging inside the range off the paths to lo and hi: O(log n).
+    template <typename TKey, typename TTraits>
+    typename RedBlackTree<TKey, TTraits>::aggregate_type
+    RedBlackTree<TKey, TTraits>::aggregate(const key_type& lo, const key_type& hi, Bounds bounds) const
+    {
+        static_assert(kAggregate, "aggregate requires AggregateTraits");
+        typedef aggregate_policy monoid;
+
+        bool left_closed(is_left_closed(bounds)), right_closed(is_right_closed(bounds));
+        auto after_lo = [&](_Base_ptr node) {
+            return left_closed ? !(key_of(node) < lo) : lo < key_of(node);
+        };
+        auto before_hi = [&](_Base_ptr node) {
+            return right_closed ? !(hi < key_of(node)) : key_of(node) < hi;
+        };
+
+        _Base_ptr split(header_.data.parent);
+        while (split && !(after_lo(split) && before_hi(split))) {
+            split = split->child[!after_lo(split)];
+        }
+        if (!split) {
+            return monoid::identity();
+        }
+
+        auto left = monoid::identity();
+        for (_Base_ptr node(split->child[Left]); node; ) {
+            if (after_lo(node)) {
+                auto subtree = monoid::combine(monoid::from_key(node->key), summary_of(node->child[Right]));
+                left = monoid::combine(subtree, left);
+                node = node->child[Left];
+            } else {
+                node = node->child[Right];
+            }
+        }
+        auto right = monoid::identity();
+        for (_Base_ptr node(split->child[Right]); node; ) {
+            if (before_hi(node)) {
+                auto subtree = monoid::combine(summary_of(node->child[Left]), monoid::from_key(node->key));
+                right = monoid::combine(right, subtree);
+                node = node->child[Right];
+            } else {
+                node = node->child[Left];
+            }
+        }
+        return monoid::combine(monoid::combine(left, monoid::from_key(split->key)), right);
+    }
+
+    // Calls fn for every key of the range in ascending order. The traversal keeps the
+    // path to the current node on an explicit stack, so moving to the next key never
+    // climbs parent links and every node is loaded exactly once.
+    template <typename TKey, typename TTraits>
+    template <typename TFunc>
+    void RedBlackTree<TKey, TTraits>::for_each_range(const key_type& lo,
+                                                     const key_type& hi,
+                                                     Bounds bounds,
+                                                     TFunc fn) const
+    {
+        bool left_closed(is_left_closed(bounds)), right_closed(is_right_closed(bounds));
+        auto after_lo = [&](_Base_ptr node) {
+            return left_closed ? !(key_of(node) < lo) : lo < key_of(node);
+        };
+        auto after_hi = [&](_Base_ptr node) {
+            return right_closed ? hi < key_of(node) : !(key_of(node) < hi);
+        };
+
+        if constexpr (!kBoundedHeight) {
+            // the path to a key may be longer than the stack
+            auto it = left_closed ? lower_bound(lo) : upper_bound(lo);
+            for (; it != end() && !after_hi(it.node); ++it) {
+                fn(*it);
+            }
+            return;
+        }
+
+        _Base_ptr stack[kMaxHeight];
+        size_t depth(0);
+        for (_Base_ptr node = header_.data.parent; node;) {
+            if (after_lo(node)) {
+                stack[depth++] = node, node = node->child[Left];
+            } else {
+                node = node->child[Right];
+            }
+        }
+
+        while (depth) {
+            _Base_ptr node = stack[--depth];
+            if (after_hi(node)) {
+                return;
+            }
+            fn(node->key);
+            for (node = node->child[Right]; node; node = node->child[Left]) {
+                stack[depth++] = node;
+            }
+        }
+    }
+
+    // Writes to out, in ascending order, the keys of the range found in the top depth
+    // levels under the highest node inside the range. Consecutive points bound runs
+    // of whole subtrees hanging at one depth, which is how parallel scans split a
+    // range into pieces. Treaps and splay trees have no height bound, a splay tree
+    // may be a path whose top levels hold almost nothing: their range is walked
+    // once and cut every count / 2^depth keys instead.
+    template <typename TKey, typename TTraits>
+    template <class _OutputIterator>
+    _OutputIterator RedBlackTree<TKey, TTraits>::split_points(const key_type& lo,
+                                                              const key_type& hi,
+                                                              Bounds bounds,
+                                                              size_t depth,
+                                                              _OutputIterator out) const
+    {
+        if constexpr (!kBoundedHeight) {
+            auto keys = range(lo, hi, bounds);
+            size_t count = std::distance(keys.begin(), keys.end());
+            size_t pieces = depth < 32 ? std::min(size_t(1) << depth, count) : count;
+            size_t step = pieces ? (count + pieces - 1) / pieces : 1;
+            size_t index(0);
+            for (auto it = keys.begin(); it != keys.end(); ++it, index++) {
+                if (index && index % step == 0) {
+                    *out++ = it;
+                }
+            }
+            return out;
+        }
+        bool left_closed(is_left_closed(bounds)), right_closed(is_right_closed(bounds));
+        auto after_lo = [&](_Base_ptr node) {
+            return left_closed ? !(key_of(node) < lo) : lo < key_of(node);
+        };
+        auto before_hi = [&](_Base_ptr node) {
+            return right_closed ? !(hi < key_of(node)) : key_of(node) < hi;
+        };
+
+        _Base_ptr split(header_.data.parent);
+        while (split && !(after_lo(split) && before_hi(split))) {
+            split = split->child[!after_lo(split)];
+        }
+
+        // subtrees left of a key before lo or right of a key after hi are skipped
+        auto visit = [&](auto& self, _Base_ptr node, size_t level) -> void {
+            if (!node || level == depth) {
+                return;
+            }
+            bool inside_lo(after_lo(node)), inside_hi(before_hi(node));
+            if (inside_lo) {
+                self(self, node->child[Left], level + 1);
+            }
+            if (inside_lo && inside_hi) {
+                *out++ = iterator(node);
+            }
+            if (inside_hi) {
+                self(self, node->child[Right], level + 1);
+            }
+        };
+        visit(visit, split, 0);
+        return out;
+    }
+
+    template <typename TKey, typename TTraits>
+    template <class _ForwardIterator, class _OutputIterator>
+    _OutputIterator RedBlackTree<TKey, TTraits>::find_many(_ForwardIterator first,
+                                                           _ForwardIterator last,
+                                                           _OutputIterator out) const
+    {
+        return descend_many(first, last, out, [](const key_type& key, _Base_ptr node, _Base_ptr& result) {
+            int order = compare_keys<TTraits>(key, key_of(node));
+            if (!order) {
+                result = node;
+                return static_cast<_Base_ptr>(nullptr);
+            }
+            return node->child[order > 0];
+        });
+    }
+
+    template <typename TKey, typename TTraits>
+    template <class _ForwardIterator, class _OutputIterator>
+    _OutputIterator RedBlackTree<TKey, TTraits>::lower_bound_many(_ForwardIterator first,
+                                                                  _ForwardIterator last,
+                                                                  _OutputIterator out) const
+    {
+        return descend_many(first, last, out, [](const key_type& key, _Base_ptr node, _Base_ptr& result) {
+            bool right = key_of(node) < key;
+            result = right ? result : node;
+            return node->child[right];
+        });
+    }
+
+    // Descents of up to kLookupGroup keys advance one level at a time in round-robin
+    // order, and the next node of every descent is prefetched. While one lookup waits
+    // for its node to arrive from memory the others make progress, so cache misses of
+    // independent lookups overlap instead of being paid one after another.
+    template <typename TKey, typename TTraits>
+    template <class _ForwardIterator, class _OutputIterator, typename TStep>
+    _OutputIterator RedBlackTree<TKey, TTraits>::descend_many(_ForwardIterator first,
+                                                              _ForwardIterator last,
+                                                              _OutputIterator out,
+                                                              const TStep& step) const
+    {
+        const key_type* keys[kLookupGroup];
+        _Base_ptr nodes[kLookupGroup];
+        _Base_ptr results[kLookupGroup];
+
+        while (first != last) {
+            size_t count(0);
+            for (; first != last && count < kLookupGroup; ++first, ++count) {
+                keys[count] = &*first;
+                nodes[count] = header_.data.parent;
+                results[count] = end().node;
+            }
+
+            for (bool active(true); active;) {
+                active = false;
+                for (size_t i(0); i < count; i++) {
+                    if (nodes[i]) {
+                        nodes[i] = step(*keys[i], nodes[i], results[i]);
+                        if (nodes[i]) {
+                            __builtin_prefetch(nodes[i]);
+                            active = true;
+                        }
+                    }
+                }
+            }
+
+            for (size_t i(0); i < count; i++) {
+                *out++ = iterator(results[i]);
+            }
+        }
+        return out;
+    }
+
+    template <typename TKey, typename TTraits>
+    typename RedBlackTree<TKey, TTraits>::iterator RedBlackTree<TKey, TTraits>::begin() const
     {
-        return iterator(header_.data.rchild);
+        return iterator(header_.data.child[Right]);
     }
 
-    template<typename TKey>
-    typename RedBlackTree<TKey>::iterator RedBlackTree<TKey>::end() const
+    template <typename TKey, typename TTraits>
+    typename RedBlackTree<TKey, TTraits>::iterator RedBlackTree<TKey, TTraits>::end() const
     {
-        return iterator(const_cast<Node<value_type>*>(&header_.data));
+        return iterator(const_cast<node_type*>(&header_.data));
     }
 
-    template<typename TKey>
-    typename RedBlackTree<TKey>::reverse_iterator RedBlackTree<TKey>::rbegin() const
+    template <typename TKey, typename TTraits>
+    typename RedBlackTree<TKey, TTraits>::reverse_iterator RedBlackTree<TKey, TTraits>::rbegin() const
     {
-        return reverse_iterator(iterator(end()));
+        return reverse_iterator(rightmost());
     }
 
-    template<typename TKey>
-    typename RedBlackTree<TKey>::reverse_iterator RedBlackTree<TKey>::rend() const
+    template <typename TKey, typename TTraits>
+    typename RedBlackTree<TKey, TTraits>::reverse_iterator RedBlackTree<TKey, TTraits>::rend() const
     {
-        return reverse_iterator(begin());
+        return reverse_iterator(end().node);
     }
 
-    template<typename TKey>
-    size_t RedBlackTree<TKey>::size() const
+    template <typename TKey, typename TTraits>
+    size_t RedBlackTree<TKey, TTraits>::size() const
     {
         return header_.nodes_count;
     }
 
-    template<typename TKey>
-    bool RedBlackTree<TKey>::empty() const
+    template <typename TKey, typename TTraits>
+    bool RedBlackTree<TKey, TTraits>::empty() const
     {
         return header_.nodes_count == 0;
     }
 
-    template<typename TKey>
-    typename RedBlackTree<TKey>::_Base_ptr RedBlackTree<TKey>::root() const
+    template <typename TKey, typename TTraits>
+    typename RedBlackTree<TKey, TTraits>::_Base_ptr RedBlackTree<TKey, TTraits>::root() const
     {
         return const_cast<_Base_ptr>(header_.data.parent);
     }
 
-    template<typename TKey>
-    typename RedBlackTree<TKey>::_Base_ptr RedBlackTree<TKey>::leftmost() const
+    template <typename TKey, typename TTraits>
+    typename RedBlackTree<TKey, TTraits>::_Base_ptr RedBlackTree<TKey, TTraits>::leftmost() const
     {
-        return header_.data.rchild;
+        return header_.data.child[Right];
     }
 
-    template<typename TKey>
-    typename RedBlackTree<TKey>::_Base_ptr RedBlackTree<TKey>::rightmost() const
+    template <typename TKey, typename TTraits>
+    typename RedBlackTree<TKey, TTraits>::_Base_ptr RedBlackTree<TKey, TTraits>::rightmost() const
     {
-        return header_.data.lchild;
+        return header_.data.child[Left];
     }
 
-    template<typename TKey>
-    typename RedBlackTree<TKey>::_Base_ptr RedBlackTree<TKey>::minimum(_Base_ptr node)
+    // Regions reserved by the node storage, all zero for HeapNodes
+    template <typename TKey, typename TTraits>
+    NodeStorageStats RedBlackTree<TKey, TTraits>::node_storage_stats() const
     {
-        while (node->lchild) {
-            node = node->lchild;
+        return storage_.stats();
+    }
+
+    template <typename TKey, typename TTraits>
+    typename RedBlackTree<TKey, TTraits>::_Base_ptr RedBlackTree<TKey, TTraits>::minimum(_Base_ptr node)
+    {
+        while (node->child[Left]) {
+            node = node->child[Left];
         }
         return node;
     }
 
-    template<typename TKey>
-    typename RedBlackTree<TKey>::_Base_ptr RedBlackTree<TKey>::maximum(_Base_ptr node)
+    template <typename TKey, typename TTraits>
+    typename RedBlackTree<TKey, TTraits>::_Base_ptr RedBlackTree<TKey, TTraits>::maximum(_Base_ptr node)
     {
-        while (node->rchild) {
-            node = node->rchild;
+        while (node->child[Right]) {
+            node = node->child[Right];
         }
         return node;
     }
@@ -329,86 +1177,141 @@ namespace stl
     /// Implementation of private template class RedBlackTree::Balancer
     ///////////////////////////////////////////////////////////////////////////////
 
-    template<typename TKey>
-    typename RedBlackTree<TKey>::_Base_ptr RedBlackTree<TKey>::Balancer::lrotate(_Base_ptr node)
+    // Moves node down to side dir, its child from the other side takes its place.
+    // Returns that child.
+    template <typename TKey, typename TTraits>
+    typename RedBlackTree<TKey, TTraits>::_Base_ptr
+    RedBlackTree<TKey, TTraits>::Balancer::rotate(_Base_ptr node, bool dir)
     {
         auto isroot = is_root(node);
-        auto rchild = node->rchild;
+        auto child = node->child[!dir];
         auto parent = node->parent;
-        rchild->parent = parent;
-        node->parent = rchild;
-        node->rchild = rchild->lchild;
-        if (node->rchild) {
-            node->rchild->parent = node;
+        child->parent = parent;
+        node->parent = child;
+        node->child[!dir] = child->child[dir];
+        if (node->child[!dir]) {
+            node->child[!dir]->parent = node;
         }
-        rchild->lchild = node;
+        child->child[dir] = node;
         if (!isroot) {
-            if (parent->is_lchild(node)) {
-                parent->lchild = rchild;
-            } else {
-                parent->rchild = rchild;
-            }
+            parent->child[parent->is_rchild(node)] = child;
         } else {
-            parent->parent = rchild;
+            parent->parent = child;
+        }
+        if constexpr (kAugmented) {
+            update(node), update(child);
         }
 
-        return rchild;
+        return child;
     }
 
-    template<typename TKey>
-    typename RedBlackTree<TKey>::_Base_ptr RedBlackTree<TKey>::Balancer::rrotate(_Base_ptr node)
+    // Rotates node above its parent, returns node
+    template <typename TKey, typename TTraits>
+    typename RedBlackTree<TKey, TTraits>::_Base_ptr
+    RedBlackTree<TKey, TTraits>::Balancer::rotate_up(_Base_ptr node)
     {
-        auto isroot = is_root(node);
-        auto lchild = node->lchild;
-        auto parent = node->parent;
-        lchild->parent = parent;
-        node->parent = lchild;
-        node->lchild = lchild->rchild;
-        if (node->lchild) {
-            node->lchild->parent = node;
+        _Base_ptr parent = node->parent;
+        return rotate(parent, !parent->is_rchild(node));
+    }
+
+    template <typename TKey, typename TTraits>
+    bool RedBlackTree<TKey, TTraits>::Balancer::is_black(_Base_ptr node)
+    {
+        return (!node || (node->color == Color::Black));
+    }
+
+    // Nodes of an AVL tree keep the height of their subtree in the color field. A
+    // leaf has height 1, i.e. Black, and no node is Red, which is_header relies on.
+    template <typename TKey, typename TTraits>
+    int RedBlackTree<TKey, TTraits>::Balancer::height(_Base_ptr node)
+    {
+        return node ? static_cast<int>(node->color) : 0;
+    }
+
+    template <typename TKey, typename TTraits>
+    void RedBlackTree<TKey, TTraits>::Balancer::fix_height(_Base_ptr node)
+    {
+        int lheight(height(node->child[Left])), rheight(height(node->child[Right]));
+        node->color = static_cast<Color>(1 + (lheight < rheight ? rheight : lheight));
+    }
+
+    // Rotates the subtree of node back into AVL balance when the heights of its
+    // children differ by two and fixes the heights. Returns the root of the subtree.
+    template <typename TKey, typename TTraits>
+    typename RedBlackTree<TKey, TTraits>::_Base_ptr
+    RedBlackTree<TKey, TTraits>::Balancer::avl_balance(_Base_ptr node)
+    {
+        int balance = height(node->child[Left]) - height(node->child[Right]);
+        if (balance > 1 || balance < -1) {
+            bool tall_side = balance < 0;
+            auto tall = node->child[tall_side];
+            if (height(tall->child[tall_side]) < height(tall->child[!tall_side])) {
+                rotate(tall, tall_side);
+                fix_height(tall);
+            }
+            node = rotate(node, !tall_side);
+            fix_height(node->child[!tall_side]);
         }
-        lchild->rchild = node;
-        if (!isroot) {
-            if (parent->is_lchild(node)) {
-                parent->lchild = lchild;
-            } else {
-                parent->rchild = lchild;
+        fix_height(node);
+        return node;
+    }
+
+    // Rebalances the ancestors of a subtree which grew or shrank, starting from its
+    // parent node. Stops at the first subtree which keeps its height.
+    template <typename TKey, typename TTraits>
+    void RedBlackTree<TKey, TTraits>::Balancer::avl_retrace(_Base_ptr node, _Base& header_data)
+    {
+        while (node != &header_data) {
+            int old_height = height(node);
+            node = avl_balance(node);
+            if (height(node) == old_height) {
+                break;
             }
-        } else {
-            parent->parent = lchild;
+            node = node->parent;
         }
+    }
 
-        return lchild;
+    // Treap priority of a node is a hash of its address: nodes need no extra field
+    // and keep their priorities when they move to another tree
+    template <typename TKey, typename TTraits>
+    uint64_t RedBlackTree<TKey, TTraits>::Balancer::priority(_Base_ptr node)
+    {
+        return mix_hash(reinterpret_cast<uintptr_t>(node));
     }
 
-    template<typename TKey>
-    bool RedBlackTree<TKey>::Balancer::is_black(_Base_ptr node)
+    // Moves node to the root by zig-zig and zig-zag steps, which roughly halve the
+    // depth of every node on the path
+    template <typename TKey, typename TTraits>
+    void RedBlackTree<TKey, TTraits>::Balancer::splay(_Base_ptr node)
     {
-        return (!node || (node->color == Color::Black));
+        while (!is_root(node)) {
+            _Base_ptr parent = node->parent;
+            if (!is_root(parent)) {
+                bool zig_zig = parent->is_lchild(node) == parent->parent->is_lchild(parent);
+                rotate_up(zig_zig ? parent : node);
+            }
+            rotate_up(node);
+        }
     }
 
-    template<typename TKey>
-    void RedBlackTree<TKey>::Balancer::relink_parent(_Base_ptr& parent,
-                                        _Base_ptr& prev,
-                                        _Base_ptr& curr,
-                                        bool prev_is_root)
+    template <typename TKey, typename TTraits>
+    void RedBlackTree<TKey, TTraits>::Balancer::relink_parent(_Base_ptr& parent,
+                                                              _Base_ptr& prev,
+                                                              _Base_ptr& curr,
+                                                              bool prev_is_root)
     {
         if (curr) {
             curr->parent = parent;
         }
         if (!prev || !prev_is_root) {
-            if (parent->is_lchild(prev)) {
-                parent->lchild = curr;
-            } else {
-                parent->rchild = curr;
-            }
+            parent->child[!parent->is_lchild(prev)] = curr;
         } else {
             parent->parent = curr;
         }
     }
 
-    template<typename TKey>
-    void RedBlackTree<TKey>::Balancer::swap(_Base_ptr& node, _Base_ptr& other)
+    template <typename TKey, typename TTraits>
+    void RedBlackTree<TKey, TTraits>::Balancer::swap(_Base_ptr& node, _Base_ptr& other)
     {
         auto node_is_root(is_root(node));
         auto other_is_root(is_root(other));
@@ -419,73 +1322,202 @@ namespace stl
                 std::pair<_Base_ptr, _Base_ptr>({ other, node });
             relink_parent(parent->parent, parent, child, is_root(parent));
             parent->parent = child;
-            parent->rchild = child->rchild;
-            if (child->rchild) {
-                child->rchild->parent = parent;
+            parent->child[Right] = child->child[Right];
+            if (child->child[Right]) {
+                child->child[Right]->parent = parent;
             }
-            child->rchild = parent;
-            child->lchild = parent->lchild;
-            if (parent->lchild) {
-                parent->lchild->parent = child;
+            child->child[Right] = parent;
+            child->child[Left] = parent->child[Left];
+            if (parent->child[Left]) {
+                parent->child[Left]->parent = child;
             }
-            parent->lchild = nullptr;
+            parent->child[Left] = nullptr;
         } else {
             auto other_parent = other->parent;
             relink_parent(node->parent, node, other, node_is_root);
             relink_parent(other_parent, other, node, other_is_root);
-            auto other_lchild = other->lchild;
-            relink_parent(other, other_lchild, node->lchild);
-            relink_parent(node, node->lchild, other_lchild);
-            auto other_rchild = other->rchild;
-            relink_parent(other, other_rchild, node->rchild);
-            relink_parent(node, node->rchild, other_rchild);
-        }
-        if (node->color != other->color) {
-            node->repaint(), other->repaint();
+            auto other_lchild = other->child[Left];
+            relink_parent(other, other_lchild, node->child[Left]);
+            relink_parent(node, node->child[Left], other_lchild);
+            auto other_rchild = other->child[Right];
+            relink_parent(other, other_rchild, node->child[Right]);
+            relink_parent(node, node->child[Right], other_rchild);
         }
+        // colors, or AVL heights, stay with the places
+        std::swap(node->color, other->color);
     }
 
-    template<typename TKey>
-    typename RedBlackTree<TKey>::_Base_ptr
-    RedBlackTree<TKey>::Balancer::insert_and_rebalance(_Base_ptr node,
-                                                       _Base_ptr parent,
-                                                       _Base& header_data)
+    // Links a new leaf under parent and keeps leftmost/rightmost of the header up to date
+    template <typename TKey, typename TTraits>
+    void RedBlackTree<TKey, TTraits>::Balancer::attach(_Base_ptr node, _Base_ptr parent, _Base& header_data)
     {
-        if (node->key < parent->key) {
-            parent->lchild = node;
-            if (parent == header_data.rchild) {
-                header_data.rchild = node;
+        if (key_of(node) < key_of(parent)) {
+            parent->child[Left] = node;
+            if (parent == header_data.child[Right]) {
+                header_data.child[Right] = node;
+            }
+            if constexpr (TTraits::threaded) {
+                thread(node, threads(parent)->prev, parent);
             }
-            node->parent = parent;
         } else {
-            parent->rchild = node;
-            if (parent == header_data.lchild) {
-                header_data.lchild = node;
+            parent->child[Right] = node;
+            if (parent == header_data.child[Left]) {
+                header_data.child[Left] = node;
             }
-            node->parent = parent;
+            if constexpr (TTraits::threaded) {
+                thread(node, parent, threads(parent)->next);
+            }
+        }
+        node->parent = parent;
+        if constexpr (kAugmented) {
+            update_path(node, header_data);
+        }
+    }
+
+    template <typename TKey, typename TTraits>
+    ThreadedNode<typename RedBlackTree<TKey, TTraits>::_Base>*
+    RedBlackTree<TKey, TTraits>::Balancer::threads(_Base_ptr node)
+    {
+        return static_cast<ThreadedNode<_Base>*>(node);
+    }
+
+    // Puts node between its in-order neighbours prev and next, the header is
+    // both ends of the ring
+    template <typename TKey, typename TTraits>
+    void RedBlackTree<TKey, TTraits>::Balancer::thread(_Base_ptr node, _Base_ptr prev, _Base_ptr next)
+    {
+        threads(node)->prev = prev;
+        threads(node)->next = next;
+        threads(prev)->next = node;
+        threads(next)->prev = node;
+    }
+
+    template <typename TKey, typename TTraits>
+    void RedBlackTree<TKey, TTraits>::Balancer::unthread(_Base_ptr node)
+    {
+        threads(threads(node)->prev)->next = threads(node)->next;
+        threads(threads(node)->next)->prev = threads(node)->prev;
+        threads(node)->next = threads(node)->prev = nullptr;
+    }
+
+    // Recomputes the summary of an augmented node from its children
+    template <typename TKey, typename TTraits>
+    void RedBlackTree<TKey, TTraits>::Balancer::update(_Base_ptr node)
+    {
+        if constexpr (TTraits::augmented) {
+            TTraits::update(node->key,
+                            node->child[Left] ? &node->child[Left]->key : nullptr,
+                            node->child[Right] ? &node->child[Right]->key : nullptr);
+        }
+        if constexpr (kAggregate) {
+            static_cast<node_type*>(node)->summary =
+                aggregate_policy::combine(aggregate_policy::combine(summary_of(node->child[Left]),
+                                                                    aggregate_policy::from_key(node->key)),
+                                          summary_of(node->child[Right]));
+        }
+    }
+
+    // Recomputes summaries from node up to the root. After an insert or erase only
+    // the ancestors of the changed leaf are stale, rotations fix the nodes they move.
+    template <typename TKey, typename TTraits>
+    void RedBlackTree<TKey, TTraits>::Balancer::update_path(_Base_ptr node, _Base& header_data)
+    {
+        for (; node != &header_data; node = node->parent) {
+            update(node);
+        }
+    }
+
+    // Unlinks a node with at most one child, its child takes its place
+    template <typename TKey, typename TTraits>
+    void RedBlackTree<TKey, TTraits>::Balancer::detach(_Base_ptr node, _Base& header_data)
+    {
+        _Base_ptr child = node->child[Left] ? node->child[Left] : node->child[Right];
+        _Base_ptr parent = node->parent;
+        bool prev_is_root = is_root(node);
+        relink_parent(parent, node, child, prev_is_root);
+        if constexpr (kAugmented) {
+            update_path(parent, header_data);
+        }
+        if constexpr (TTraits::threaded) {
+            unthread(node);
+        }
+
+        if (!header_data.parent) {
+            header_data.child[Right] = header_data.child[Left] = &header_data;
+            return;
+        }
+        if (header_data.child[Right] == node) {
+            header_data.child[Right] = child ? minimum(child) : parent;
+        }
+        if (header_data.child[Left] == node) {
+            header_data.child[Left] = child ? maximum(child) : parent;
+        }
+    }
+
+    // Unlinks a node with at most one child for the balancing schemes other than
+    // red-black, its child takes its place. As in erase_and_rebalance the node is
+    // left pointing to its old parent or to the child, see RedBlackTree::unlink.
+    // Returns the parent of the place.
+    template <typename TKey, typename TTraits>
+    typename RedBlackTree<TKey, TTraits>::_Base_ptr
+    RedBlackTree<TKey, TTraits>::Balancer::splice(_Base_ptr node, _Base& header_data)
+    {
+        _Base_ptr child = node->child[Left] ? node->child[Left] : node->child[Right];
+        _Base_ptr parent = node->parent;
+        relink_parent(parent, node, child, is_root(node));
+        if (header_data.child[Right] == node) {
+            header_data.child[Right] = child ? minimum(child) : parent;
+        }
+        if (header_data.child[Left] == node) {
+            header_data.child[Left] = child ? maximum(child) : parent;
+        }
+        if (child) {
+            node->parent = child;
+        }
+        if constexpr (kAugmented) {
+            update_path(parent, header_data);
+        }
+        return parent;
+    }
+
+    template <typename TKey, typename TTraits>
+    typename RedBlackTree<TKey, TTraits>::_Base_ptr
+    RedBlackTree<TKey, TTraits>::Balancer::insert_and_rebalance(_Base_ptr node,
+                                                                _Base_ptr parent,
+                                                                _Base& header_data)
+    {
+        attach(node, parent, header_data);
+
+        if constexpr (kAvl) {
+            fix_height(node);
+            avl_retrace(parent, header_data);
+            return node;
+        } else if constexpr (kTreap) {
+            node->repaint(Color::Black);
+            while (!is_root(node) && priority(node->parent) < priority(node)) {
+                rotate_up(node);
+            }
+            return node;
+        } else if constexpr (kSplay) {
+            node->repaint(Color::Black);
+            splay(node);
+            return node;
         }
 
         while (node->color == Color::Red && node->parent->color == Color::Red) {
             parent = node->parent;
             auto grandpa = parent->parent;
-            bool node_is_left(parent->is_lchild(node));
-            bool parent_is_left = (grandpa->lchild == parent);
-            auto uncle = parent_is_left ? grandpa->rchild : grandpa->lchild;
+            bool parent_side(grandpa->is_rchild(parent));
+            auto uncle = grandpa->child[!parent_side];
 
             if (uncle && uncle->color == Color::Red) {
                 uncle->repaint(), parent->repaint(), grandpa->repaint();
                 node = grandpa;
+            } else if (parent->is_rchild(node) == parent_side) {
+                node = rotate(grandpa, !parent_side);
+                parent->repaint(), grandpa->repaint();
             } else {
-                if (node_is_left == parent_is_left) {
-                    node = node_is_left ? rrotate(grandpa) : lrotate(grandpa);
-                    parent->repaint(), grandpa->repaint();
-                } else {
-                    if (parent_is_left) {
-                        node = lrotate(parent)->lchild;
-                    } else {
-                        node = rrotate(parent)->rchild;
-                    }
-                }
+                node = rotate(parent, parent_side)->child[parent_side];
             }
 
             if (node->parent == &header_data) {
@@ -495,35 +1527,66 @@ namespace stl
         return node;
     }
 
-    template<typename TKey>
-    void RedBlackTree<TKey>::Balancer::erase_and_rebalance(_Base_ptr node, _Base& header_data)
+    // Returns the node which left the tree: node itself or, when its key was replaced
+    // by a copy of the successor key, the node of the successor
+    template <typename TKey, typename TTraits>
+    typename RedBlackTree<TKey, TTraits>::_Base_ptr
+    RedBlackTree<TKey, TTraits>::Balancer::erase_and_rebalance(_Base_ptr node, _Base& header_data)
     {
         auto isroot(is_root(node));
-        if (isroot && header_data.rchild == node && header_data.lchild == node) {
-            header_data.rchild = header_data.lchild = &header_data;
+        if (isroot && header_data.child[Right] == node && header_data.child[Left] == node) {
+            header_data.child[Right] = header_data.child[Left] = &header_data;
             header_data.parent = nullptr;
-            return;
+            return node;
         }
 
-        if (node->lchild && node->rchild) {
-            auto upbound = node->rchild;
-            while (upbound->lchild) {
-                upbound = upbound->lchild;
+        if constexpr (kAvl || kTreap || kSplay) {
+            if constexpr (kTreap) {
+                // sinks the node below its children in heap order
+                while (node->child[Left] && node->child[Right]) {
+                    rotate_up(node->child[priority(node->child[Left]) < priority(node->child[Right])]);
+                }
+            } else if (node->child[Left] && node->child[Right]) {
+                auto upbound = minimum(node->child[Right]);
+                if constexpr (kCopyKeysOnErase) {
+                    node->key = upbound->key;
+                    node = upbound;
+                } else {
+                    swap(node, upbound);
+                }
+            }
+            _Base_ptr parent = splice(node, header_data);
+            if constexpr (kAvl) {
+                avl_retrace(parent, header_data);
+            } else if constexpr (kSplay) {
+                if (parent != &header_data) {
+                    splay(parent);
+                }
+            }
+            return node;
+        }
+
+        if (node->child[Left] && node->child[Right]) {
+            auto upbound = node->child[Right];
+            while (upbound->child[Left]) {
+                upbound = upbound->child[Left];
+            }
+            if constexpr (kCopyKeysOnErase) {
+                node->key = upbound->key;
+                node = upbound;
+            } else {
+                swap(node, upbound);
             }
-            swap(node, upbound);
             isroot = false;
         }
+        _Base_ptr removed(node);
 
         _Base_ptr child(nullptr);
-        if ((child = node->lchild ? node->lchild : node->rchild)) {
+        if ((child = node->child[Left] ? node->child[Left] : node->child[Right])) {
             child->parent = node->parent;
             node->parent = child;
             if (!isroot) {
-                if (child->parent->is_lchild(node)) {
-                    child->parent->lchild = child;
-                } else {
-                    child->parent->rchild = child;
-                }
+                child->parent->child[child->parent->is_rchild(node)] = child;
             } else {
                 child->parent->parent = child;
             }
@@ -532,11 +1595,11 @@ namespace stl
             }
         }
 
-        if (header_data.rchild == node) {
-            header_data.rchild = node->parent;
+        if (header_data.child[Right] == node) {
+            header_data.child[Right] = node->parent;
         }
-        if (header_data.lchild == node) {
-            header_data.lchild = node->parent;
+        if (header_data.child[Left] == node) {
+            header_data.child[Left] = node->parent;
         }
 
         if (node->color == Color::Black) {
@@ -544,10 +1607,11 @@ namespace stl
 
             while (rebalance) {
                 _Base_ptr bug_node = node->parent;
-                bool brother_left = bug_node->is_rchild(node);
-                _Base_ptr brother = brother_left ? bug_node->lchild : bug_node->rchild;
+                bool side = bug_node->is_rchild(node);
+                _Base_ptr brother = bug_node->child[!side];
                 if (brother->color == Color::Black) {
-                    if (is_black(brother->lchild) && is_black(brother->rchild)) {
+                    _Base_ptr near(brother->child[side]), far(brother->child[!side]);
+                    if (is_black(near) && is_black(far)) {
                         brother->repaint();
                         if (is_black(bug_node)) {
                             node = bug_node;
@@ -556,41 +1620,150 @@ namespace stl
                             bug_node->repaint();
                             rebalance = false;
                         }
-                    } else if (!is_black(brother->rchild)) {
-                        if (brother_left) {
-                            lrotate(brother);
-                            brother->repaint();
-                            brother->parent->repaint();
-                        } else {
-                            lrotate(bug_node);
-                            brother->rchild->repaint(Color::Black);
-                            brother->repaint(bug_node->color);
-                            bug_node->repaint(Color::Black);
-                            rebalance = false;
-                        }
+                    } else if (!is_black(far)) {
+                        rotate(bug_node, side);
+                        far->repaint(Color::Black);
+                        brother->repaint(bug_node->color);
+                        bug_node->repaint(Color::Black);
+                        rebalance = false;
                     } else {
-                        if (brother_left) {
-                            rrotate(bug_node);
-                            brother->lchild->repaint(Color::Black);
-                            brother->repaint(bug_node->color);
-                            bug_node->repaint(Color::Black);
-                            rebalance = false;
-                        } else {
-                            rrotate(brother);
-                            brother->repaint();
-                            brother->parent->repaint();
-                        }
+                        // a red near nephew becomes the far one of a red brother
+                        rotate(brother, !side);
+                        brother->repaint();
+                        brother->parent->repaint();
                     }
                 } else {
-                    if (brother_left) {
-                        rrotate(bug_node);
-                    } else {
-                        lrotate(bug_node);
-                    }
+                    rotate(bug_node, side);
                     bug_node->repaint();
                     brother->repaint();
                 }
             }
         }
+        return removed;
+    }
+
+    // Top-down insertion: every node with two red children met on the way down is
+    // split by a color flip, and a red parent created by the flip is fixed with a
+    // rotation at once. The uncle of the new leaf is never red, so the leaf is
+    // fixed with at most one more rotation and nothing is climbed afterwards.
+    // Returns the new node or nullptr if val is already in the tree.
+    template <typename TKey, typename TTraits>
+    typename RedBlackTree<TKey, TTraits>::_Base_ptr
+    RedBlackTree<TKey, TTraits>::Balancer::insert_top_down(const value_type& val,
+                                                           _Base& header_data,
+                                                           storage_type& storage)
+    {
+        _Base_ptr node(header_data.parent), parent(nullptr), inserted(nullptr);
+        while (true) {
+            if (!node) {
+                node = inserted = storage.create(val);
+                attach(node, parent, header_data);
+            } else if (!is_black(node->child[Left]) && !is_black(node->child[Right])) {
+                node->repaint(is_root(node) ? Color::Black : Color::Red);
+                node->child[Left]->repaint(Color::Black);
+                node->child[Right]->repaint(Color::Black);
+            }
+
+            if (!is_black(node) && !is_root(node) && !is_black(node->parent)) {
+                // the parent is red, so it is not the root and the grandparent is black
+                auto red_parent = node->parent;
+                auto grandpa = red_parent->parent;
+                bool parent_side(grandpa->is_rchild(red_parent));
+                if (red_parent->is_rchild(node) == parent_side) {
+                    rotate(grandpa, !parent_side);
+                    red_parent->repaint(Color::Black);
+                } else {
+                    rotate(red_parent, parent_side);
+                    rotate(grandpa, !parent_side);
+                    node->repaint(Color::Black);
+                }
+                grandpa->repaint(Color::Red);
+            }
+
+            if (inserted) {
+                break;
+            }
+            parent = node;
+            int order = compare_keys<TTraits>(TTraits::key_of(val), key_of(node));
+            if (!order) {
+                break;
+            }
+            node = node->child[order > 0];
+        }
+        header_data.parent->repaint(Color::Black);
+        return inserted;
+    }
+
+    // Top-down deletion: the descent makes the current node red before leaving it,
+    // borrowing from the sibling or pushing red down with rotations. The search goes
+    // on to the successor of the erased node, which then is a red leaf or the root
+    // with at most one child and can be unlinked without any fix up. The erased node
+    // is relinked into the place of its successor rather than copying keys, so
+    // iterators to other nodes stay valid. Returns the unlinked node or nullptr.
+    template <typename TKey, typename TTraits>
+    typename RedBlackTree<TKey, TTraits>::_Base_ptr
+    RedBlackTree<TKey, TTraits>::Balancer::erase_top_down(const key_type& val, _Base& header_data)
+    {
+        _Base_ptr node(header_data.parent), found(nullptr);
+        while (node) {
+            int order = compare_keys<TTraits>(val, key_of(node));
+            bool dir = order >= 0;
+            if (!order) {
+                found = node;
+            }
+            _Base_ptr next = node->child[dir];
+            _Base_ptr other = node->child[!dir];
+
+            if (is_black(node) && is_black(next)) {
+                if (!is_black(other)) {
+                    rotate(node, dir);
+                    node->repaint(Color::Red);
+                    other->repaint(Color::Black);
+                } else if (!is_root(node)) {
+                    _Base_ptr parent = node->parent;
+                    bool side = parent->is_rchild(node);
+                    _Base_ptr sibling = parent->child[!side];
+                    if (sibling) {
+                        _Base_ptr near = sibling->child[side];
+                        _Base_ptr far = sibling->child[!side];
+                        if (is_black(near) && is_black(far)) {
+                            parent->repaint(Color::Black);
+                            sibling->repaint(Color::Red);
+                            node->repaint(Color::Red);
+                        } else {
+                            if (!is_black(near)) {
+                                rotate(sibling, !side);
+                            }
+                            _Base_ptr top = rotate(parent, side);
+                            node->repaint(Color::Red);
+                            top->repaint(Color::Red);
+                            top->child[Left]->repaint(Color::Black);
+                            top->child[Right]->repaint(Color::Black);
+                        }
+                    }
+                }
+            }
+
+            if (!next) {
+                break;
+            }
+            node = next;
+        }
+
+        if (found) {
+            if (found != node) {
+                if constexpr (kCopyKeysOnErase) {
+                    found->key = node->key;
+                    found = node;
+                } else {
+                    swap(found, node);
+                }
+            }
+            detach(found, header_data);
+        }
+        if (header_data.parent) {
+            header_data.parent->repaint(Color::Black);
+        }
+        return found;
     }
 }
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+namespace stl
+{
+    // Statistics counter bumped by const lookups, which several threads may run
+    // at once on the same container. Increments are relaxed atomics: the counts
+    // are exact, but do not order other memory accesses. A copy takes the value.
+    class RelaxedCounter
+    {
+     public:
+        explicit RelaxedCounter(size_t value = 0) : value_(value) { }
+
+        RelaxedCounter(const RelaxedCounter& other) : value_(size_t(other)) { }
+
+        RelaxedCounter& operator=(const RelaxedCounter& other)
+        {
+            value_.store(size_t(other), std::memory_order_relaxed);
+            return *this;
+        }
+
+        RelaxedCounter& operator+=(size_t delta)
+        {
+            value_.fetch_add(delta, std::memory_order_relaxed);
+            return *this;
+        }
+
+        RelaxedCounter& operator++()
+        {
+            return *this += 1;
+        }
+
+        operator size_t() const
+        {
+            return value_.load(std::memory_order_relaxed);
+        }
+
+     private:
+        std::atomic<size_t> value_;
+    };
+}
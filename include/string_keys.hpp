@@ -0,0 +1,302 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace stl
+{
+    // First 8 bytes of str as a big-endian number, padded with zero bytes: for
+    // strings which differ in their first 8 bytes, comparing the prefixes as
+    // numbers gives the order of std::string, which compares unsigned chars.
+    inline uint64_t key_prefix(std::string_view str)
+    {
+        uint64_t prefix(0);
+        for (size_t i(0); i < sizeof(prefix); i++) {
+            prefix <<= 8;
+            if (i < str.size()) {
+                prefix |= uint8_t(str[i]);
+            }
+        }
+        return prefix;
+    }
+
+    // Order of std::string over strings with precomputed prefixes. The bytes are
+    // read only when the prefixes tie and both strings are longer than a prefix:
+    // otherwise the shorter string is a prefix of the other.
+    inline bool prefix_less(uint64_t left_prefix,
+                            std::string_view left,
+                            uint64_t right_prefix,
+                            std::string_view right)
+    {
+        if (left_prefix != right_prefix) {
+            return left_prefix < right_prefix;
+        }
+        if (left.size() <= sizeof(uint64_t) || right.size() <= sizeof(uint64_t)) {
+            return left.size() < right.size();
+        }
+        return left.substr(sizeof(uint64_t)) < right.substr(sizeof(uint64_t));
+    }
+
+    // Three-way version of prefix_less, lets a tree descent compare once per level
+    inline int prefix_compare(uint64_t left_prefix,
+                              std::string_view left,
+                              uint64_t right_prefix,
+                              std::string_view right)
+    {
+        if (left_prefix != right_prefix) {
+            return left_prefix < right_prefix ? -1 : 1;
+        }
+        if (left.size() <= sizeof(uint64_t) || right.size() <= sizeof(uint64_t)) {
+            return (left.size() > right.size()) - (left.size() < right.size());
+        }
+        return left.substr(sizeof(uint64_t)).compare(right.substr(sizeof(uint64_t)));
+    }
+
+    inline bool prefix_equal(uint64_t left_prefix,
+                             std::string_view left,
+                             uint64_t right_prefix,
+                             std::string_view right)
+    {
+        if (left_prefix != right_prefix || left.size() != right.size()) {
+            return false;
+        }
+        return left.size() <= sizeof(uint64_t) ||
+               left.substr(sizeof(uint64_t)) == right.substr(sizeof(uint64_t));
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////
+    /// Class PrefixString
+    ///////////////////////////////////////////////////////////////////////////////
+
+    // String key which keeps the key_prefix of its bytes next to them. In a tree
+    // node the prefix lies in the node itself, so a lookup descending through
+    // Set<PrefixString> compares numbers at every level and loads the heap buffer
+    // of a long string only when its first 8 bytes equal those of the searched
+    // key. Costs 8 bytes per key over std::string.
+
+    class PrefixString
+    {
+     public:
+        PrefixString() : prefix_(0) { }
+
+        // the prefix is read from str before it is moved
+        explicit PrefixString(std::string str) : prefix_(key_prefix(str)), str_(std::move(str)) { }
+
+        explicit PrefixString(const char* str) : PrefixString(std::string(str)) { }
+
+        const std::string& str() const
+        {
+            return str_;
+        }
+
+        uint64_t prefix() const
+        {
+            return prefix_;
+        }
+
+        int compare(const PrefixString& other) const
+        {
+            return prefix_compare(prefix_, str_, other.prefix_, other.str_);
+        }
+
+        friend bool operator<(const PrefixString& left, const PrefixString& right)
+        {
+            return prefix_less(left.prefix_, left.str_, right.prefix_, right.str_);
+        }
+
+        friend bool operator==(const PrefixString& left, const PrefixString& right)
+        {
+            return prefix_equal(left.prefix_, left.str_, right.prefix_, right.str_);
+        }
+
+        friend bool operator!=(const PrefixString& left, const PrefixString& right)
+        {
+            return !(left == right);
+        }
+
+     private:
+        uint64_t prefix_;
+        std::string str_;
+    };
+
+    ///////////////////////////////////////////////////////////////////////////////
+    /// Class ArenaString
+    ///////////////////////////////////////////////////////////////////////////////
+
+    // String key made of a key_prefix and a view of bytes it does not own, 24
+    // bytes stored in the node. Keys of a set are made by StringArena::add, which
+    // copies the bytes into the arena; a key built directly from a string_view
+    // does not copy and serves for lookups, e.g. set.contains(ArenaString(str)).
+
+    class ArenaString
+    {
+     public:
+        ArenaString() : prefix_(0), data_(""), size_(0) { }
+
+        explicit ArenaString(std::string_view str)
+            : prefix_(key_prefix(str))
+            , data_(str.data())
+            , size_(str.size()) { }
+
+        std::string_view view() const
+        {
+            return std::string_view(data_, size_);
+        }
+
+        uint64_t prefix() const
+        {
+            return prefix_;
+        }
+
+        int compare(const ArenaString& other) const
+        {
+            return prefix_compare(prefix_, view(), other.prefix_, other.view());
+        }
+
+        friend bool operator<(const ArenaString& left, const ArenaString& right)
+        {
+            return prefix_less(left.prefix_, left.view(), right.prefix_, right.view());
+        }
+
+        friend bool operator==(const ArenaString& left, const ArenaString& right)
+        {
+            return prefix_equal(left.prefix_, left.view(), right.prefix_, right.view());
+        }
+
+        friend bool operator!=(const ArenaString& left, const ArenaString& right)
+        {
+            return !(left == right);
+        }
+
+     private:
+        uint64_t prefix_;
+        const char* data_;
+        size_t size_;
+    };
+
+    ///////////////////////////////////////////////////////////////////////////////
+    /// Class StringArena
+    ///////////////////////////////////////////////////////////////////////////////
+
+    // Bump allocator for the bytes of string keys. Strings are copied one after
+    // another into chunks of kChunkSize bytes, so keys added together lie together
+    // in memory instead of in separate heap blocks, and a string costs its length
+    // with no malloc header. Bytes are released only by clear() or destruction,
+    // erasing a key from a set does not return them; the arena must outlive the
+    // keys it made.
+
+    class StringArena
+    {
+     public:
+        static constexpr size_t kChunkSize = 64 * 1024;
+
+        StringArena() : current_(nullptr), left_(0), memory_(0) { }
+
+        StringArena(const StringArena&) = delete;
+        StringArena& operator=(const StringArena&) = delete;
+
+        // The moved-from arena is empty: its chunks, and the bytes its keys view,
+        // belong to the target
+        StringArena(StringArena&& other) noexcept
+            : chunks_(std::move(other.chunks_))
+            , current_(other.current_)
+            , left_(other.left_)
+            , memory_(other.memory_)
+        {
+            other.clear();
+        }
+
+        StringArena& operator=(StringArena&& other) noexcept
+        {
+            if (&other != this) {
+                chunks_ = std::move(other.chunks_);
+                current_ = other.current_, left_ = other.left_, memory_ = other.memory_;
+                other.clear();
+            }
+            return *this;
+        }
+
+        // Copies str into the arena and returns a key viewing the copy
+        ArenaString add(std::string_view str)
+        {
+            return ArenaString(store(str));
+        }
+
+        std::string_view store(std::string_view str)
+        {
+            if (str.size() > left_) {
+                if (str.size() > kChunkSize / 4) {
+                    // a long string takes a chunk of its own, the current one goes on
+                    return std::string_view(copy(allocate(str.size()), str), str.size());
+                }
+                current_ = allocate(kChunkSize);
+                left_ = kChunkSize;
+            }
+            char* data = copy(current_, str);
+            current_ += str.size(), left_ -= str.size();
+            return std::string_view(data, str.size());
+        }
+
+        // Bytes of the chunks, used or not
+        size_t memory_usage() const
+        {
+            return memory_;
+        }
+
+        void clear()
+        {
+            chunks_.clear();
+            current_ = nullptr;
+            left_ = memory_ = 0;
+        }
+
+     private:
+        std::vector<std::unique_ptr<char[]>> chunks_;
+        char* current_;
+        size_t left_;
+        size_t memory_;
+
+        char* allocate(size_t size)
+        {
+            chunks_.emplace_back(new char[size]);
+            memory_ += size;
+            return chunks_.back().get();
+        }
+
+        static char* copy(char* dest, std::string_view str)
+        {
+            if (!str.empty()) {
+                std::memcpy(dest, str.data(), str.size());
+            }
+            return dest;
+        }
+    };
+}
+
+namespace std
+{
+    template <>
+    struct hash<stl::PrefixString>
+    {
+        size_t operator()(const stl::PrefixString& key) const
+        {
+            return hash<string>()(key.str());
+        }
+    };
+
+    template <>
+    struct hash<stl::ArenaString>
+    {
+        size_t operator()(const stl::ArenaString& key) const
+        {
+            return hash<string_view>()(key.view());
+        }
+    };
+}
@@ -0,0 +1,259 @@
+#pragma once
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+namespace stl
+{
+    ///////////////////////////////////////////////////////////////////////////////
+    /// Policies of RedBlackTree
+    ///////////////////////////////////////////////////////////////////////////////
+
+    // Rebalancing strategies used by insert and erase of a key.
+    // BottomUpRebalance descends to the place of the key and fixes colors on the
+    // way back to the root. TopDownRebalance recolors and rotates while descending,
+    // so every level of the tree is visited once.
+    struct BottomUpRebalance { };
+    struct TopDownRebalance { };
+
+    // Other balancing schemes sharing the rotations of the red-black tree.
+    // AvlRebalance keeps the heights of sibling subtrees within one of each other,
+    // so lookups descend at most 1.44 log2(n) levels instead of 2 log2(n), for
+    // more rotations on updates. The color field of a node keeps its height.
+    // TreapRebalance keeps nodes in heap order of a hash of their addresses, which
+    // makes a random tree of expected O(log n) depth with few rotations per update.
+    // SplayRebalance moves every inserted or found key to the root: hot keys of a
+    // skewed workload stay near the top at O(log n) amortized cost. find() then
+    // changes the tree, so even const lookups must not run concurrently.
+    struct AvlRebalance { };
+    struct TreapRebalance { };
+    struct SplayRebalance { };
+
+    // Storage of tree nodes. HeapNodes allocates every node with new.
+    // HugePageNodes takes nodes one after another from large regions of the tree
+    // backed by 2 MiB pages where the system allows, see NodeArena: a lookup in a
+    // set of millions of keys then misses the TLB on a few pages instead of on
+    // nearly every level.
+    struct HeapNodes { };
+    struct HugePageNodes { };
+
+    struct NoAggregate
+    {
+        typedef void value_type;
+    };
+
+    // Default policies of a tree. Override a member in a derived struct to change
+    // a single policy, e.g.
+    //     struct MyTraits : TreeTraits<int> { typedef TopDownRebalance rebalance; };
+    //     stl::Set<int, MyTraits> set;
+    template <typename TKey>
+    struct TreeTraits
+    {
+        // Part of a stored element which is compared, the element itself for sets
+        typedef TKey key_type;
+
+        static const key_type& key_of(const TKey& value)
+        {
+            return value;
+        }
+
+        typedef BottomUpRebalance rebalance;
+
+        // Inserting an element equal to a present one does nothing. When it is
+        // false, equal elements are kept in the order of insertion.
+        static constexpr bool unique_keys = true;
+
+        // When true, the tree calls
+        //     static void update(TKey& value, const TKey* left, const TKey* right)
+        // for every node whose subtree has changed, children before parents, so an
+        // element can keep a summary of its subtree in a part which is not compared.
+        // left and right are the elements of the children or nullptr.
+        static constexpr bool augmented = false;
+
+        // Nodes keep links to their in-order neighbours: iterator steps are O(1) in
+        // the worst case instead of climbing the tree, for two more pointers per node.
+        static constexpr bool threaded = false;
+
+        // Monoid aggregated over every subtree for RedBlackTree::aggregate, see
+        // AggregateTraits. NoAggregate keeps plain nodes.
+        typedef NoAggregate aggregate;
+
+        // Iterators to a key stay valid until the key itself is erased. When it is
+        // false, erasing a node with two children may copy its successor key into it
+        // and free the successor node instead, see copy_keys_on_erase_v.
+        static constexpr bool stable_iterators = true;
+
+        // Lookups and inserts which tell less, equal and greater apart compare a
+        // key once per level with compare_keys instead of calling operator< twice.
+        // A static int compare(const key_type&, const key_type&) of the traits or
+        // a compare() member of the key, like std::string::compare, must then agree
+        // with operator<.
+        static constexpr bool three_way_compare = true;
+
+        typedef HeapNodes node_storage;
+    };
+
+    template <typename TKey>
+    struct FastEraseTreeTraits : TreeTraits<TKey>
+    {
+        static constexpr bool stable_iterators = false;
+    };
+
+    template <typename TKey>
+    struct ThreadedTreeTraits : TreeTraits<TKey>
+    {
+        static constexpr bool threaded = true;
+    };
+
+    // Erasing a node with two children has to put its in-order successor in its
+    // place. Relinking the successor node rewrites up to six parent/child pairs
+    // but never moves keys. A small trivially copyable key is cheaper to copy, so
+    // this is done when the traits allow to invalidate iterators to the successor.
+    template <typename TKey, typename TTraits>
+    inline constexpr bool copy_keys_on_erase_v = !TTraits::stable_iterators &&
+                                                 std::is_trivially_copyable_v<TKey> &&
+                                                 sizeof(TKey) <= 2 * sizeof(void*);
+
+    template <typename TTraits, typename = void>
+    struct has_traits_compare : std::false_type { };
+
+    template <typename TTraits>
+    struct has_traits_compare<TTraits, std::void_t<decltype(TTraits::compare(
+        std::declval<const typename TTraits::key_type&>(),
+        std::declval<const typename TTraits::key_type&>()))>>
+        : std::true_type { };
+
+    template <typename T>
+    inline constexpr bool is_signed_integral_v = std::is_integral_v<T> && std::is_signed_v<T>;
+
+    template <typename TKey, typename = void>
+    struct has_member_compare : std::false_type { };
+
+    // compare() must return a signed integer: a bool compare() is an equality
+    // test or a less-than, not a three-way comparison
+    template <typename TKey>
+    struct has_member_compare<TKey, std::enable_if_t<is_signed_integral_v<decltype(
+        std::declval<const TKey&>().compare(std::declval<const TKey&>()))>>>
+        : std::true_type { };
+
+    // Negative, zero or positive as left is less than, equal to or greater than
+    // right: the compare of the traits if there is one, otherwise a compare()
+    // member of the key, otherwise two calls of operator<.
+    template <typename TTraits>
+    inline int compare_keys(const typename TTraits::key_type& left, const typename TTraits::key_type& right)
+    {
+        typedef typename TTraits::key_type key_type;
+        if constexpr (TTraits::three_way_compare && has_traits_compare<TTraits>::value) {
+            auto order = TTraits::compare(left, right);
+            return (order > 0) - (order < 0);
+        } else if constexpr (TTraits::three_way_compare && has_member_compare<key_type>::value) {
+            auto order = left.compare(right);
+            return (order > 0) - (order < 0);
+        } else {
+            return left < right ? -1 : int(right < left);
+        }
+    }
+
+    template <typename TKey>
+    struct TopDownTreeTraits : TreeTraits<TKey>
+    {
+        typedef TopDownRebalance rebalance;
+    };
+
+    template <typename TKey>
+    struct AvlTreeTraits : TreeTraits<TKey>
+    {
+        typedef AvlRebalance rebalance;
+    };
+
+    template <typename TKey>
+    struct TreapTreeTraits : TreeTraits<TKey>
+    {
+        typedef TreapRebalance rebalance;
+    };
+
+    template <typename TKey>
+    struct SplayTreeTraits : TreeTraits<TKey>
+    {
+        typedef SplayRebalance rebalance;
+    };
+
+    template <typename TKey>
+    struct HugePageTreeTraits : TreeTraits<TKey>
+    {
+        typedef HugePageNodes node_storage;
+    };
+
+    template <typename TKey>
+    struct MultiSetTraits : TreeTraits<TKey>
+    {
+        static constexpr bool unique_keys = false;
+    };
+
+    // A monoid over keys provides
+    //     typedef ... value_type;
+    //     static value_type identity();
+    //     static value_type from_key(const TKey& key);
+    //     static value_type combine(const value_type& left, const value_type& right);
+    // combine must be associative, it is always applied in key order.
+    template <typename TKey, typename TMonoid>
+    struct AggregateTraits : TreeTraits<TKey>
+    {
+        typedef TMonoid aggregate;
+    };
+
+    template <typename TKey, typename TValue = TKey>
+    struct SumMonoid
+    {
+        typedef TValue value_type;
+
+        static value_type identity()
+        {
+            return value_type();
+        }
+
+        static value_type from_key(const TKey& key)
+        {
+            return value_type(key);
+        }
+
+        static value_type combine(const value_type& left, const value_type& right)
+        {
+            return left + right;
+        }
+    };
+
+    template <typename TKey>
+    struct CountMonoid
+    {
+        typedef size_t value_type;
+
+        static value_type identity()
+        {
+            return 0;
+        }
+
+        static value_type from_key(const TKey&)
+        {
+            return 1;
+        }
+
+        static value_type combine(const value_type& left, const value_type& right)
+        {
+            return left + right;
+        }
+    };
+
+    // Maps store key/value pairs ordered by the key
+    template <typename TKey, typename TValue>
+    struct MapTraits : TreeTraits<std::pair<const TKey, TValue>>
+    {
+        typedef TKey key_type;
+
+        static const key_type& key_of(const std::pair<const TKey, TValue>& value)
+        {
+            return value.first;
+        }
+    };
+}
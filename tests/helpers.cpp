@@ -1,6 +1,15 @@
 #include "helpers.h"
 #include <random>
 #include <algorithm>
+#include <cmath>
+#include <cerrno>
+#include <cstring>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 
 namespace stl::unittests::datagen
 {
@@ -41,4 +50,99 @@ namespace stl::unittests::datagen
         }
         return data;
     }
+
+    std::vector<int> make_zipf_rank_data(int size, int nb_ranks, double skew, unsigned seed)
+    {
+        std::vector<double> cumulative(nb_ranks);
+        double total(0);
+        for (int rank(0); rank < nb_ranks; rank++) {
+            total += 1.0 / std::pow(rank + 1, skew);
+            cumulative[rank] = total;
+        }
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<double> dist(0, total);
+        std::vector<int> data(size);
+        std::generate(data.begin(), data.end(), [&]() {
+            auto it = std::lower_bound(cumulative.begin(), cumulative.end(), dist(rng));
+            return std::min<int>(it - cumulative.begin(), nb_ranks - 1);
+        });
+        return data;
+    }
+}
+
+namespace stl::unittests
+{
+#ifdef __linux__
+    PerfCounter::PerfCounter(Event event) : fd_(-1), errno_(0)
+    {
+        perf_event_attr attr{};
+        attr.size = sizeof(attr);
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        switch (event) {
+        case Event::BranchMisses:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+            break;
+        case Event::DTlbLoadMisses:
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                          (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+            break;
+        }
+        fd_ = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        errno_ = fd_ < 0 ? errno : 0;
+    }
+
+    PerfCounter::~PerfCounter()
+    {
+        if (fd_ >= 0) {
+            close(fd_);
+        }
+    }
+
+    void PerfCounter::start()
+    {
+        if (fd_ >= 0) {
+            ioctl(fd_, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+
+    uint64_t PerfCounter::stop()
+    {
+        uint64_t count(0);
+        if (fd_ >= 0) {
+            ioctl(fd_, PERF_EVENT_IOC_DISABLE, 0);
+            if (read(fd_, &count, sizeof(count)) != sizeof(count)) {
+                count = 0;
+            }
+        }
+        return count;
+    }
+#else
+    PerfCounter::PerfCounter(Event) : fd_(-1), errno_(ENOSYS) { }
+
+    PerfCounter::~PerfCounter() { }
+
+    void PerfCounter::start() { }
+
+    uint64_t PerfCounter::stop()
+    {
+        return 0;
+    }
+#endif
+
+    bool PerfCounter::available() const
+    {
+        return fd_ >= 0;
+    }
+
+    // Why perf_event_open failed: EACCES or EPERM when it is not allowed, ENOENT
+    // when the CPU has no such counter
+    const char* PerfCounter::error() const
+    {
+        return std::strerror(errno_);
+    }
 }
@@ -1,3 +1,4 @@
+#include <cstdint>
 #include <vector>
 #include <string>
 
@@ -9,5 +10,36 @@ namespace stl::unittests::datagen
                                           unsigned seed = 42);
     std::vector<char> make_random_char_data(int size, unsigned seed = 42);
     std::vector<std::string> make_random_string_data(int size, unsigned seed = 42);
+    // Ranks in [0, nb_ranks) drawn with probability proportional to 1 / (rank + 1)^skew,
+    // rank 0 is the most frequent
+    std::vector<int> make_zipf_rank_data(int size, int nb_ranks, double skew = 1.0, unsigned seed = 42);
 
 }
+
+namespace stl::unittests
+{
+    // Hardware event counter of the calling thread, user space only, read with
+    // perf_event_open on Linux. available() is false where the kernel or the
+    // sandbox does not allow it or the CPU exposes no such counter, e.g. in
+    // virtual machines; error() then tells why and benchmarks print times only.
+    class PerfCounter
+    {
+     public:
+        enum class Event { BranchMisses, DTlbLoadMisses };
+
+        explicit PerfCounter(Event event);
+        ~PerfCounter();
+        PerfCounter(const PerfCounter&) = delete;
+        PerfCounter& operator=(const PerfCounter&) = delete;
+
+        bool available() const;
+        const char* error() const;
+        void start();
+        // Events counted since start()
+        uint64_t stop();
+
+     private:
+        int fd_;
+        int errno_;
+    };
+}
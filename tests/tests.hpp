@@ -1,17 +1,34 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
 #include <iostream>
 #include <vector>
 #include <string>
+#include <string_view>
 #include <chrono>
+#include <iomanip>
 #include <random>
 #include <sstream>
+#include <map>
+#include <numeric>
 #include <set>
+#include <thread>
+#include <unordered_set>
 #include <gtest/gtest.h>
 
 #include "redblacktree.hpp"
 #include "Set.hpp"
+#include "SharedSet.hpp"
+#include "Map.hpp"
+#include "MultiSet.hpp"
+#include "IntervalSet.hpp"
+#include "StaticSet.hpp"
+#include "SmallSet.hpp"
+#include "FlatSet.hpp"
+#include "HashedSet.hpp"
+#include "parallel.hpp"
+#include "string_keys.hpp"
 
 namespace stl::unittests
 {
@@ -61,8 +78,8 @@ namespace stl::unittests
         return sstream.str();
     }
 
-    template<typename value_type>
-    bool rbtree_verify(RedBlackTree<value_type>& rb_tree, bool debug = false)
+    template<typename value_type, typename traits>
+    bool rbtree_verify(RedBlackTree<value_type, traits>& rb_tree, bool debug = false)
     {
         bool is_correct(true);
         if (!rb_tree.size() || rb_tree.begin() == rb_tree.end()) {
@@ -82,7 +99,7 @@ namespace stl::unittests
         if (root) {
             size_t black_len = rbtree_black_count(rb_tree.leftmost(), root);
             for (auto iter(rb_tree.begin()); iter != rb_tree.end(); iter++) {
-                auto node(iter.node), lchild(iter.node->lchild), rchild(iter.node->rchild);
+                auto node(iter.node), lchild(iter.node->child[Left]), rchild(iter.node->child[Right]);
 
                 if (node->color == Color::Red) {
                     if ((lchild && lchild->color == Color::Red) ||
@@ -131,7 +148,7 @@ namespace stl::unittests
         start = std::chrono::steady_clock::now();
         op(args...);
         finish = std::chrono::steady_clock::now();
-        auto duration = std::chrono::duration_cast<std::chrono::seconds>(finish - start).count();
+        auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(finish - start).count();
         return duration;
     }
 
@@ -156,10 +173,10 @@ namespace stl::unittests
                                 const Args&... args)
     {
         auto duration = timeit(rbt_op, retry, rb_tree, args...) / complete_count;
-        std::cout << "\tstl::Set: " << duration << "s" << std::endl;
+        std::cout << "\tstl::Set: " << duration << "ns" << std::endl;
 
         duration = timeit(set_op, retry, set, args...) / complete_count;
-        std::cout << "\tstd::set: " << duration << "s" << std::endl;
+        std::cout << "\tstd::set: " << duration << "ns" << std::endl;
     }
 
     template<typename container, typename value_type>
@@ -2,6 +2,9 @@
 #include "tests.hpp"
 #include "helpers.h"
 
+#include <sys/wait.h>
+#include <unistd.h>
+
 
 namespace stl::unittests
 {
@@ -38,6 +41,91 @@ namespace stl::unittests
         }
     }
 
+    TEST(StlRedBlackTree, CheckTopDownInsert) {
+        auto data = datagen::make_random_int_data(2000, -1000, 1000);
+        RedBlackTree<int, TopDownTreeTraits<int>> rb_tree;
+        std::set<int> set;
+        for (auto& val: data) {
+            rb_tree.insert(val);
+            set.insert(val);
+            rbtree_verify(rb_tree);
+        }
+        check_container_equality(set, rb_tree);
+
+        RedBlackTree<int, TopDownTreeTraits<int>> sorted_tree;
+        for (int val(0); val < 1000; val++) {
+            sorted_tree.insert(val);
+        }
+        rbtree_verify(sorted_tree);
+        EXPECT_EQ(sorted_tree.size(), 1000u);
+    }
+
+    TEST(StlRedBlackTree, CheckTopDownErase) {
+        auto data = datagen::make_random_int_data(2000, -1000, 1000);
+        RedBlackTree<int, TopDownTreeTraits<int>> rb_tree(data.begin(), data.end());
+        std::set<int> set(data.begin(), data.end());
+        auto first = rb_tree.begin();
+        std::shuffle(data.begin(), data.end(), std::default_random_engine());
+        for (auto& val: data) {
+            bool erase_first = (val == *first);
+            rb_tree.erase(val + 5000);  // absent key
+            rb_tree.erase(val);
+            set.erase(val);
+            if (!erase_first) {
+                EXPECT_EQ(*first, *set.begin()) << "Iterator to another node is invalidated";
+            } else {
+                first = rb_tree.begin();
+            }
+            rbtree_verify(rb_tree);
+            check_container_equality(set, rb_tree);
+        }
+        EXPECT_TRUE(rb_tree.empty());
+        EXPECT_EQ(rb_tree.begin(), rb_tree.end());
+
+        std::initializer_list<std::string> list{"a", "b", "c", "d", "e", "f", "g", "h"};
+        RedBlackTree<std::string, TopDownTreeTraits<std::string>> srbt(list);
+        for (auto& val: list) {
+            srbt.erase(val);
+            rbtree_verify(srbt);
+        }
+        EXPECT_TRUE(srbt.empty());
+    }
+
+    TEST(StlRedBlackTree, CheckCopyKeysOnErase) {
+        static_assert(copy_keys_on_erase_v<int, FastEraseTreeTraits<int>>);
+        static_assert(!copy_keys_on_erase_v<int, TreeTraits<int>>);
+        static_assert(!copy_keys_on_erase_v<std::string, FastEraseTreeTraits<std::string>>);
+
+        auto data = datagen::make_random_int_data(2000, -1000, 1000);
+        RedBlackTree<int, FastEraseTreeTraits<int>> rb_tree(data.begin(), data.end());
+        std::set<int> set(data.begin(), data.end());
+        std::shuffle(data.begin(), data.end(), std::default_random_engine());
+        for (size_t i(0); i < data.size(); i++) {
+            if (i % 2) {
+                rb_tree.erase(data[i]);
+                set.erase(data[i]);
+            } else {
+                auto it = rb_tree.find(data[i]);
+                if (it != rb_tree.end()) {
+                    auto next = set.upper_bound(data[i]);
+                    it = rb_tree.erase(it);
+                    EXPECT_TRUE(next == set.end() ? it == rb_tree.end() : *it == *next);
+                    set.erase(data[i]);
+                }
+            }
+            rbtree_verify(rb_tree);
+            check_container_equality(set, rb_tree);
+        }
+
+        std::initializer_list<std::string> list{"a", "b", "c", "d", "e", "f", "g", "h"};
+        RedBlackTree<std::string, FastEraseTreeTraits<std::string>> srbt(list);
+        for (auto& val: list) {
+            srbt.erase(val);
+            rbtree_verify(srbt);
+        }
+        EXPECT_TRUE(srbt.empty());
+    }
+
     TEST(StlSet, CheckBase) {
         internal_tests::run_all();
     }
@@ -211,6 +299,1992 @@ namespace stl::unittests
         EXPECT_EQ(stlset.rbegin(), stlset.rend()) << "rbegin iterator is not equal to rend iterator";
     }
 
+    TEST(StlSet, CheckFindMany) {
+        auto data = datagen::make_random_int_data(5000, -5000, 5000);
+        stl::Set<int> stlset(data.begin(), data.end());
+        auto keys = datagen::make_random_int_data(1000, -6000, 6000, 7);
+
+        std::vector<stl::Set<int>::iterator> found, bounds;
+        stlset.find_many(keys, std::back_inserter(found));
+        stlset.lower_bound_many(keys, std::back_inserter(bounds));
+        EXPECT_EQ(found.size(), keys.size());
+        EXPECT_EQ(bounds.size(), keys.size());
+        for (size_t i(0); i < keys.size(); i++) {
+            EXPECT_EQ(found[i], stlset.find(keys[i]));
+            EXPECT_EQ(bounds[i], stlset.lower_bound(keys[i]));
+        }
+
+        stl::Set<int> empty;
+        found.clear();
+        empty.find_many(keys, std::back_inserter(found));
+        EXPECT_TRUE(std::all_of(found.begin(), found.end(), [&empty](auto it) { return it == empty.end(); }));
+    }
+
+    TEST(StlSet, CompareFindManyTime) {
+        int nb_values(1000000);
+        auto data = datagen::make_random_int_data(nb_values, 0, nb_values * 4);
+        stl::Set<int> stlset(data.begin(), data.end());
+        auto keys = datagen::make_random_int_data(nb_values, 0, nb_values * 4, 7);
+        std::vector<stl::Set<int>::iterator> found(keys.size());
+
+        std::cout << "Find operation for a batch of keys:" << std::endl;
+        auto duration = timeit([&]() {
+            auto out = found.begin();
+            for (auto& key: keys) {
+                *out++ = stlset.find(key);
+            }
+        }, 3) / keys.size();
+        std::cout << "\tfind: " << duration << "ns" << std::endl;
+        duration = timeit([&]() { stlset.find_many(keys, found.begin()); }, 3) / keys.size();
+        std::cout << "\tfind_many: " << duration << "ns" << std::endl;
+    }
+
+    TEST(StlSet, CheckFilter) {
+        int nb_values(20000);
+        auto data = datagen::make_random_int_data(nb_values, 0, nb_values * 10);
+        std::set<int> set(data.begin(), data.end());
+        stl::Set<int> stlset(data.begin(), data.end());
+        stlset.enable_filter(10);
+
+        for (int val(0); val < nb_values * 10; val++) {
+            EXPECT_EQ(set.count(val) != 0, stlset.contains(val));
+        }
+        auto stats = stlset.filter_stats();
+        EXPECT_EQ(stats.lookups, size_t(nb_values * 10));
+        EXPECT_GT(stats.rejected, 0u);
+        EXPECT_GT(stats.memory_bytes, 0u);
+        EXPECT_LT(stats.false_positive_rate(), 0.05);
+        EXPECT_LT(stats.expected_false_positive_rate, 0.05);
+        std::cout << "Filter false positive rate: " << stats.false_positive_rate()
+                  << " (expected " << stats.expected_false_positive_rate << ")" << std::endl;
+
+        for (auto& val: data) {
+            set.erase(val);
+            stlset.erase(val);
+            EXPECT_EQ(stlset.find(val), stlset.end());
+        }
+        for (int val(0); val < nb_values; val++) {
+            set.insert(val);
+            stlset.insert(val);
+            EXPECT_NE(stlset.find(val), stlset.end());
+        }
+        check_container_equality(set, stlset);
+
+        auto copy(stlset);
+        EXPECT_NE(copy.find(nb_values / 2), copy.end());
+        stlset.clear();
+        EXPECT_FALSE(stlset.contains(nb_values / 2));
+        stlset.disable_filter();
+        EXPECT_EQ(stlset.filter_stats().memory_bytes, 0u);
+        EXPECT_THROW(stlset.enable_filter(0), std::invalid_argument);
+        EXPECT_THROW(stlset.enable_filter(-1), std::invalid_argument);
+
+        // const lookups only read the filter, so concurrent readers are safe
+        stlset.enable_filter();
+        for (int val(0); val < nb_values; val++) {
+            stlset.insert(val);
+        }
+        for (int val(0); val < nb_values; val += 2) {
+            stlset.erase(val);
+        }
+        const auto& readers = stlset;
+        std::vector<std::thread> threads;
+        std::atomic<size_t> found(0);
+        for (int thread(0); thread < 4; thread++) {
+            threads.emplace_back([&]() {
+                for (int val(0); val < nb_values; val++) {
+                    found += readers.contains(val);
+                }
+            });
+        }
+        for (auto& thread: threads) {
+            thread.join();
+        }
+        EXPECT_EQ(found, 4 * stlset.size());
+        EXPECT_EQ(stlset.filter_stats().lookups, 4u * nb_values);
+    }
+
+    TEST(StlRedBlackTree, CheckSeek) {
+        auto data = datagen::make_random_int_data(2000, -2000, 2000);
+        RedBlackTree<int> rb_tree(data.begin(), data.end());
+        auto targets = datagen::make_random_int_data(2000, -2100, 2100, 7);
+        auto from = rb_tree.begin();
+        for (auto& val: targets) {
+            auto it = rb_tree.seek(from, val);
+            EXPECT_EQ(it, rb_tree.lower_bound(val));
+            from = it;
+        }
+        EXPECT_EQ(rb_tree.seek(rb_tree.end(), 3000), rb_tree.end());
+        EXPECT_EQ(rb_tree.seek(rb_tree.end(), -3000), rb_tree.begin());
+        RedBlackTree<int> empty;
+        EXPECT_EQ(empty.seek(empty.end(), 0), empty.end());
+    }
+
+    TEST(StlRedBlackTree, CheckHintInsertAndErase) {
+        RedBlackTree<int> rb_tree;
+        std::set<int> set;
+        auto data = datagen::make_random_int_data(1000, -500, 500);
+        auto hint = rb_tree.end();
+        for (auto& val: data) {
+            hint = rb_tree.insert(hint, val);
+            set.insert(val);
+            EXPECT_EQ(*hint, val);
+            rbtree_verify(rb_tree);
+        }
+        check_container_equality(set, rb_tree);
+
+        for (auto it = rb_tree.begin(); it != rb_tree.end();) {
+            auto next = std::next(it);
+            EXPECT_EQ(rb_tree.erase(it), next);
+            set.erase(set.begin());
+            it = next;
+            rbtree_verify(rb_tree);
+        }
+        check_container_equality(set, rb_tree);
+    }
+
+    TEST(StlSet, CheckCursor) {
+        auto data = datagen::make_random_int_data(1000, 0, 4000);
+        std::set<int> set(data.begin(), data.end());
+        stl::Set<int> stlset(data.begin(), data.end());
+
+        // merge a sorted stream into the set: odd keys are inserted, even keys erased
+        auto stream = datagen::make_random_int_data(1000, 0, 4000, 7);
+        std::sort(stream.begin(), stream.end());
+        auto cursor = stlset.cursor();
+        for (auto& val: stream) {
+            auto it = cursor.seek(val);
+            EXPECT_EQ(it, stlset.lower_bound(val));
+            if (val % 2) {
+                EXPECT_EQ(*cursor.insert(val), val);
+                set.insert(val);
+            } else if (!cursor.at_end() && *cursor == val) {
+                cursor.erase();
+                set.erase(val);
+            }
+        }
+        check_container_equality(set, stlset);
+
+        cursor.seek(-1);
+        EXPECT_EQ(cursor.position(), stlset.begin());
+        ++cursor;
+        --cursor;
+        EXPECT_EQ(cursor.position(), stlset.begin());
+    }
+
+    TEST(StlSet, CheckRange) {
+        auto data = datagen::make_random_int_data(500, -500, 500);
+        std::set<int> set(data.begin(), data.end());
+        stl::Set<int> stlset(data.begin(), data.end());
+        auto bounds = { Bounds::Closed, Bounds::Open, Bounds::LeftOpen, Bounds::RightOpen };
+        auto limits = datagen::make_random_int_data(200, -600, 600, 7);
+
+        for (size_t i(0); i + 1 < limits.size(); i += 2) {
+            int lo(limits[i]), hi(limits[i + 1]);
+            for (auto bound: bounds) {
+                std::vector<int> expected;
+                for (auto& val: set) {
+                    bool after_lo = is_left_closed(bound) ? lo <= val : lo < val;
+                    bool before_hi = is_right_closed(bound) ? val <= hi : val < hi;
+                    if (after_lo && before_hi) {
+                        expected.push_back(val);
+                    }
+                }
+
+                auto view = stlset.range(lo, hi, bound);
+                EXPECT_EQ(view.size(), expected.size());
+                EXPECT_EQ(view.empty(), expected.empty());
+                EXPECT_TRUE(std::equal(view.begin(), view.end(), expected.begin(), expected.end()));
+                EXPECT_TRUE(std::equal(view.rbegin(), view.rend(), expected.rbegin(), expected.rend()));
+
+                std::vector<int> visited;
+                stlset.for_each_range(lo, hi, [&visited](int val) { visited.push_back(val); }, bound);
+                EXPECT_EQ(visited, expected);
+            }
+        }
+        EXPECT_TRUE(stl::Set<int>().range(0, 10).empty());
+    }
+
+    TEST(StlSet, CompareRangeScanTime) {
+        int nb_values(1000000);
+        auto data = datagen::make_random_int_data(nb_values, 0, nb_values);
+        stl::Set<int> stlset(data.begin(), data.end());
+
+        std::cout << "Range scan over the whole set:" << std::endl;
+        int64_t sum(0);
+        auto duration = timeit([&]() {
+            for (auto val: stlset.range(0, nb_values)) {
+                sum += val;
+            }
+        }, 3) / stlset.size();
+        std::cout << "\trange view: " << duration << "ns" << std::endl;
+        duration = timeit([&]() {
+            stlset.for_each_range(0, nb_values, [&sum](int val) { sum += val; });
+        }, 3) / stlset.size();
+        std::cout << "\tfor_each_range: " << duration << "ns" << std::endl;
+        EXPECT_NE(sum, 0);
+    }
+
+    TEST(StlSharedSet, CheckPublishAndOpen) {
+        std::string name = "/stlset_unittests_" + std::to_string(getpid());
+        auto data = datagen::make_random_int_data(1000, -1000, 1000);
+        stl::Set<int> stlset(data.begin(), data.end());
+        std::set<int> set(data.begin(), data.end());
+
+        SharedSet<int>::remove(name);
+        auto writer = SharedSet<int>::create(name, stlset);
+        EXPECT_THROW(SharedSet<int>::create(name, stlset), std::system_error);
+
+        auto reader = SharedSet<int>::open(name);
+        check_container_equality(set, reader);
+        for (int val(-1001); val <= 1001; val++) {
+            EXPECT_EQ(set.count(val) != 0, reader.contains(val));
+            auto lower = set.lower_bound(val);
+            auto upper = set.upper_bound(val);
+            EXPECT_EQ(lower == set.end(), reader.lower_bound(val) == reader.end());
+            EXPECT_EQ(upper == set.end(), reader.upper_bound(val) == reader.end());
+            if (lower != set.end()) {
+                EXPECT_EQ(*lower, *reader.lower_bound(val));
+            }
+            if (upper != set.end()) {
+                EXPECT_EQ(*upper, *reader.upper_bound(val));
+            }
+        }
+
+        pid_t pid = fork();
+        if (pid == 0) {
+            auto child_reader = SharedSet<int>::open(name);
+            bool same = child_reader.size() == set.size() &&
+                std::equal(set.begin(), set.end(), child_reader.begin());
+            _exit(same ? 0 : 1);
+        }
+        int status(-1);
+        waitpid(pid, &status, 0);
+        EXPECT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0) << "Child process sees another set";
+
+        SharedSet<int>::remove(name);
+        EXPECT_THROW(SharedSet<int>::open(name), std::system_error);
+        EXPECT_EQ(reader.size(), set.size()) << "Mapping must outlive the segment name";
+    }
+
+    TEST(StlSharedSet, CheckEmpty) {
+        std::string name = "/stlset_unittests_empty_" + std::to_string(getpid());
+        SharedSet<int>::remove(name);
+        auto writer = SharedSet<int>::create(name, stl::Set<int>());
+        auto reader = SharedSet<int>::open(name);
+        EXPECT_TRUE(reader.empty());
+        EXPECT_EQ(reader.begin(), reader.end());
+        EXPECT_EQ(reader.find(0), reader.end());
+        SharedSet<int>::remove(name);
+    }
+
+    TEST(StlSet, CompareClearTime) {
+        int nb_values(1000000);
+        auto data = datagen::make_random_int_data(nb_values, 0, nb_values);
+        stl::Set<int> stlset(data.begin(), data.end());
+        std::set<int> set(data.begin(), data.end());
+        auto size = stlset.size();
+
+        std::cout << "Clear operation:" << std::endl;
+        std::cout << "\tstl::Set: " << timer([&stlset]() { stlset.clear(); }) / size << "ns" << std::endl;
+        std::cout << "\tstd::set: " << timer([&set]() { set.clear(); }) / size << "ns" << std::endl;
+        EXPECT_TRUE(stlset.empty());
+
+        stlset.insert(1);
+        EXPECT_EQ(stlset.size(), 1u);
+        EXPECT_EQ(*stlset.begin(), 1);
+    }
+
+    TEST(StlSet, CompareRebalanceTime) {
+        int nb_values(300000);
+        std::vector<std::pair<std::string, std::vector<int>>> sequences;
+        sequences.emplace_back("random", datagen::make_random_int_data(nb_values, 0, nb_values));
+        std::vector<int> ascending(nb_values);
+        std::iota(ascending.begin(), ascending.end(), 0);
+        sequences.emplace_back("ascending", ascending);
+        sequences.emplace_back("descending", std::vector<int>(ascending.rbegin(), ascending.rend()));
+        std::vector<int> zigzag;
+        for (int i(0); i < nb_values / 2; i++) {
+            zigzag.push_back(i), zigzag.push_back(nb_values - i);
+        }
+        sequences.emplace_back("zigzag", zigzag);
+
+        for (auto& [name, data]: sequences) {
+            std::cout << "Insert/erase of " << name << " keys:" << std::endl;
+            stl::Set<int> bottom_up;
+            stl::Set<int, TopDownTreeTraits<int>> top_down;
+            auto insert_time = timer([&]() { insert_data(bottom_up, data); }) / nb_values;
+            std::cout << "\tbottom-up insert: " << insert_time << "ns" << std::endl;
+            insert_time = timer([&]() { insert_data(top_down, data); }) / nb_values;
+            std::cout << "\ttop-down insert: " << insert_time << "ns" << std::endl;
+            auto erase_time = timer([&]() { erase_data(bottom_up, data); }) / nb_values;
+            std::cout << "\tbottom-up erase: " << erase_time << "ns" << std::endl;
+            erase_time = timer([&]() { erase_data(top_down, data); }) / nb_values;
+            std::cout << "\ttop-down erase: " << erase_time << "ns" << std::endl;
+            EXPECT_TRUE(bottom_up.empty() && top_down.empty());
+        }
+    }
+
+    TEST(StlSet, CompareEraseStrategyTime) {
+        for (int nb_values: {20000, 500000}) {
+            auto data = datagen::make_random_int_data(nb_values, 0, nb_values * 4);
+            auto order = data;
+            std::shuffle(order.begin(), order.end(), std::default_random_engine());
+            stl::Set<int> relink(data.begin(), data.end());
+            stl::Set<int, FastEraseTreeTraits<int>> copy(data.begin(), data.end());
+
+            std::cout << "Erase operation, " << nb_values << " keys:" << std::endl;
+            std::cout << "\trelink successor: " << timer([&]() { erase_data(relink, order); }) / nb_values
+                      << "ns" << std::endl;
+            std::cout << "\tcopy successor key: " << timer([&]() { erase_data(copy, order); }) / nb_values
+                      << "ns" << std::endl;
+            EXPECT_TRUE(relink.empty() && copy.empty());
+        }
+    }
+
+    TEST(StlMap, CheckInsertAndFind) {
+        auto data = datagen::make_random_int_data(2000, -500, 500);
+        stl::Map<int, std::string> map;
+        std::map<int, std::string> expected;
+        for (auto val: data) {
+            EXPECT_EQ(map.insert({val, std::to_string(val)}).second,
+                      expected.insert({val, std::to_string(val)}).second);
+        }
+        ASSERT_EQ(map.size(), expected.size());
+        EXPECT_TRUE(std::equal(map.begin(), map.end(), expected.begin(), expected.end()));
+        for (int key(-600); key < 600; key++) {
+            EXPECT_EQ(map.contains(key), expected.count(key) == 1);
+            auto it = map.lower_bound(key);
+            auto exp = expected.lower_bound(key);
+            EXPECT_TRUE(exp == expected.end() ? it == map.end() : it->first == exp->first);
+        }
+        EXPECT_THROW(map.at(1000), std::out_of_range);
+    }
+
+    TEST(StlMap, CheckAccessAndErase) {
+        stl::Map<std::string, int> map;
+        for (auto& word: datagen::make_random_string_data(500)) {
+            map[word]++;
+        }
+        int total(0);
+        for (auto& [word, count]: map) {
+            total += count;
+        }
+        EXPECT_EQ(total, 500);
+
+        EXPECT_FALSE(map.try_emplace("word", 1).second == map.try_emplace("word", 2).second);
+        EXPECT_EQ(map.at("word"), 1);
+        EXPECT_FALSE(map.insert_or_assign("word", 3).second);
+        EXPECT_EQ(map["word"], 3);
+        map.find("word")->second = 4;
+        EXPECT_EQ(map.at("word"), 4);
+
+        while (!map.empty()) {
+            map.erase(map.begin());
+        }
+        map.erase("absent");
+        EXPECT_TRUE(map.empty() && map.begin() == map.end());
+    }
+
+    struct Event
+    {
+        int time, seq;
+
+        bool operator<(const Event& other) const
+        {
+            return time < other.time;
+        }
+
+        friend std::ostream& operator<<(std::ostream& os, const Event& event)
+        {
+            return os << event.time << "#" << event.seq;
+        }
+    };
+
+    TEST(StlMultiSet, CheckInsertOrderAndEqualRange) {
+        auto data = datagen::make_random_int_data(3000, 0, 100);
+        RedBlackTree<Event, MultiSetTraits<Event>> rb_tree;
+        std::multiset<Event> expected;
+        for (size_t i(0); i < data.size(); i++) {
+            rb_tree.insert({data[i], int(i)});
+            expected.insert({data[i], int(i)});
+        }
+        rbtree_verify(rb_tree);
+        ASSERT_EQ(rb_tree.size(), data.size());
+        EXPECT_TRUE(std::equal(rb_tree.begin(), rb_tree.end(), expected.begin(), expected.end(),
+                               [](auto& a, auto& b) { return a.time == b.time && a.seq == b.seq; }));
+
+        for (int time(-1); time <= 101; time++) {
+            auto [first, last] = rb_tree.equal_range({time, 0});
+            auto [exp_first, exp_last] = expected.equal_range({time, 0});
+            EXPECT_EQ(rb_tree.count({time, 0}), expected.count({time, 0}));
+            EXPECT_TRUE(first == rb_tree.lower_bound({time, 0}) && last == rb_tree.upper_bound({time, 0}));
+            EXPECT_EQ(std::distance(first, last), std::distance(exp_first, exp_last));
+        }
+    }
+
+    struct CopyKeysMultiSetTraits : MultiSetTraits<int>
+    {
+        static constexpr bool stable_iterators = false;
+    };
+
+    TEST(StlMultiSet, CheckErase) {
+        auto data = datagen::make_random_int_data(3000, -50, 50);
+        stl::MultiSet<int> set(data.begin(), data.end());
+        std::multiset<int> expected(data.begin(), data.end());
+        for (int key(-60); key <= 60; key += 3) {
+            EXPECT_EQ(set.erase(key), expected.erase(key));
+            EXPECT_FALSE(set.contains(key));
+            check_container_equality(expected, set);
+        }
+        auto it = set.erase(set.find(1), set.upper_bound(10));
+        expected.erase(expected.find(1), expected.upper_bound(10));
+        EXPECT_EQ(*it, *expected.upper_bound(10));
+        check_container_equality(expected, set);
+
+        // copying keys on erase frees the node of the range end
+        stl::MultiSet<int, CopyKeysMultiSetTraits> same{1, 7, 7, 7, 7, 7, 9};
+        EXPECT_EQ(same.count(7), 5);
+        EXPECT_EQ(same.erase(7), 5);
+        EXPECT_EQ(*same.erase(same.begin(), std::prev(same.end())), 9);
+        EXPECT_EQ(same.erase(9), 1);
+        EXPECT_TRUE(same.empty() && same.begin() == same.end());
+    }
+
+    struct TopDownIntervalTraits : IntervalTraits<int>
+    {
+        typedef TopDownRebalance rebalance;
+        static constexpr bool stable_iterators = false;
+    };
+
+    template <typename traits>
+    void check_interval_set()
+    {
+        auto starts = datagen::make_random_int_data(3000, 0, 1000);
+        auto lengths = datagen::make_random_int_data(3000, 0, 50, 7);
+        std::vector<Interval<int>> intervals;
+        stl::IntervalSet<int, traits> set;
+        for (size_t i(0); i < starts.size(); i++) {
+            intervals.push_back({starts[i], starts[i] + lengths[i]});
+            set.insert(intervals.back());
+        }
+        std::shuffle(intervals.begin(), intervals.end(), std::default_random_engine());
+        std::set<Interval<int>> expected(intervals.begin(), intervals.end());
+
+        auto check_max_end = [&]() {
+            for (auto it = set.begin(); it != set.end(); ++it) {
+                auto max_end = it->end;
+                for (auto child: {it.node->child[Left], it.node->child[Right]}) {
+                    max_end = child ? std::max(max_end, child->key.max_end) : max_end;
+                }
+                EXPECT_EQ(it->max_end, max_end);
+            }
+        };
+        auto check_queries = [&](int lo, int hi) {
+            std::vector<Interval<int>> found, overlap, stab;
+            set.overlapping(lo, hi, std::back_inserter(found));
+            std::copy_if(expected.begin(), expected.end(), std::back_inserter(overlap),
+                         [&](auto& interval) { return interval.overlaps({lo, hi}); });
+            EXPECT_TRUE(found == overlap);
+            found.clear();
+            set.stabbing(lo, std::back_inserter(found));
+            std::copy_if(expected.begin(), expected.end(), std::back_inserter(stab),
+                         [&](auto& interval) { return interval.contains(lo); });
+            EXPECT_TRUE(found == stab);
+        };
+
+        check_max_end();
+        for (size_t i(0); i < intervals.size(); i++) {
+            if (i % 300 == 0) {
+                check_max_end();
+                for (int lo(-10); lo < 1100; lo += 97) {
+                    check_queries(lo, lo + (lo % 40));
+                }
+            }
+            set.erase(intervals[i]);
+            expected.erase(intervals[i]);
+            ASSERT_EQ(set.size(), expected.size());
+        }
+        EXPECT_TRUE(set.empty());
+    }
+
+    TEST(StlIntervalSet, CheckMaxEndAndQueries) {
+        static_assert(copy_keys_on_erase_v<IntervalEntry<int>, TopDownIntervalTraits>);
+        check_interval_set<IntervalTraits<int>>();
+        check_interval_set<TopDownIntervalTraits>();
+    }
+
+    struct ConcatMonoid
+    {
+        typedef std::string value_type;
+
+        static value_type identity()
+        {
+            return "";
+        }
+
+        static value_type from_key(char key)
+        {
+            return std::string(1, key);
+        }
+
+        static value_type combine(const value_type& left, const value_type& right)
+        {
+            return left + right;
+        }
+    };
+
+    TEST(StlSet, CheckAggregate) {
+        auto data = datagen::make_random_int_data(2000, -1000, 1000);
+        stl::Set<int, AggregateTraits<int, SumMonoid<int, long>>> set;
+        std::set<int> expected;
+        for (size_t i(0); i < data.size(); i++) {
+            if (i % 3 == 2) {
+                set.erase(data[i - 1]), expected.erase(data[i - 1]);
+            } else {
+                set.insert(data[i]), expected.insert(data[i]);
+            }
+            if (i % 50 == 0) {
+                for (int lo(-1100); lo < 1100; lo += 113) {
+                    for (auto bounds: {Bounds::Closed, Bounds::Open, Bounds::LeftOpen, Bounds::RightOpen}) {
+                        long sum(0);
+                        set.for_each_range(lo, lo + 250, [&](int key) { sum += key; }, bounds);
+                        EXPECT_EQ(set.aggregate(lo, lo + 250, bounds), sum);
+                    }
+                }
+            }
+        }
+        EXPECT_EQ(set.aggregate(-1000, 1000), std::accumulate(expected.begin(), expected.end(), 0L));
+        EXPECT_EQ(set.aggregate(5, 1), 0);
+
+        // combine is not commutative, the order of keys must be kept
+        auto chars = datagen::make_random_char_data(500);
+        stl::Set<char, AggregateTraits<char, ConcatMonoid>> letters(chars.begin(), chars.end());
+        std::string all(letters.begin(), letters.end());
+        EXPECT_EQ(letters.aggregate(all.front(), all.back()), all);
+        EXPECT_EQ(letters.aggregate(all[1], all[all.size() - 2], Bounds::Open),
+                  all.substr(2, all.size() - 4));
+    }
+
+    TEST(StlSet, CompareAggregateTime) {
+        for (int nb_values: {10000, 300000}) {
+            auto data = datagen::make_random_int_data(nb_values, 0, nb_values * 4);
+            stl::Set<int, AggregateTraits<int, SumMonoid<int, long>>> set(data.begin(), data.end());
+            long by_scan(0), by_aggregate(0);
+            auto scan = [&]() {
+                for (int lo(0); lo < nb_values * 4; lo += nb_values / 4) {
+                    set.for_each_range(lo, lo + nb_values, [&](int key) { by_scan += key; });
+                }
+            };
+            auto aggregate = [&]() {
+                for (int lo(0); lo < nb_values * 4; lo += nb_values / 4) {
+                    by_aggregate += set.aggregate(lo, lo + nb_values);
+                }
+            };
+            std::cout << "Range sum, " << nb_values << " keys, 16 ranges of ~" << nb_values / 4 << " keys:"
+                      << std::endl;
+            std::cout << "\tfor_each_range: " << timer(scan) / 16 << "ns" << std::endl;
+            std::cout << "\taggregate: " << timer(aggregate) / 16 << "ns" << std::endl;
+            EXPECT_EQ(by_scan, by_aggregate);
+        }
+    }
+
+    TEST(StlStaticSet, CheckConstexpr) {
+        constexpr StaticSet primes{11, 7, 2, 5, 3, 7};
+        static_assert(std::is_same_v<decltype(primes), const StaticSet<int, 6>>);
+        static_assert(primes.size() == 5 && *primes.begin() == 2);
+        static_assert(primes.contains(5) && !primes.contains(4) && !primes.contains(12));
+        static_assert(*primes.lower_bound(4) == 5 && *primes.upper_bound(7) == 11);
+        static_assert(primes.upper_bound(11) == primes.end());
+
+        constexpr StaticSet<std::string_view, 4> words{"while", "for", "if"};
+        static_assert(words.size() == 3 && words.contains("if") && !words.contains("do"));
+
+        constexpr StaticSet<int, 0> none{};
+        static_assert(none.empty() && none.find(1) == none.end());
+    }
+
+    TEST(StlStaticSet, CheckAgainstSet) {
+        std::initializer_list<int> list{3, 1, 4, 1, 5, 9, 2, 6, 5, 3, 5, 8, 9, 7, 9};
+        StaticSet<int, 15> digits(list);
+        stl::Set<int> expected(list);
+        check_container_equality(expected, digits);
+        EXPECT_TRUE(std::equal(digits.rbegin(), digits.rend(), expected.rbegin(), expected.rend()));
+        for (int val(-1); val < 11; val++) {
+            EXPECT_EQ(digits.contains(val), expected.contains(val));
+            EXPECT_EQ(digits.lower_bound(val) == digits.end(), expected.lower_bound(val) == expected.end());
+            if (digits.lower_bound(val) != digits.end()) {
+                EXPECT_EQ(*digits.lower_bound(val), *expected.lower_bound(val));
+                EXPECT_EQ(*digits.upper_bound(val), *expected.upper_bound(val));
+            }
+        }
+        EXPECT_THROW((StaticSet<int, 2>{1, 2, 3}), std::length_error);
+    }
+
+    TEST(StlSmallSet, CheckModeSwitch) {
+        auto data = datagen::make_random_int_data(200, -100, 100);
+        stl::SmallSet<int, 8> set;
+        std::set<int> expected;
+        for (auto val: data) {
+            set.insert(val), expected.insert(val);
+            EXPECT_EQ(set.is_tree(), expected.size() > 8);
+            check_container_equality(expected, set);
+        }
+        EXPECT_TRUE(std::equal(set.rbegin(), set.rend(), expected.rbegin(), expected.rend()));
+        for (int val(-110); val < 110; val++) {
+            EXPECT_EQ(set.contains(val), expected.count(val) == 1);
+            auto it = set.upper_bound(val);
+            auto exp = expected.upper_bound(val);
+            EXPECT_TRUE(exp == expected.end() ? it == set.end() : *it == *exp);
+        }
+
+        std::shuffle(data.begin(), data.end(), std::default_random_engine());
+        for (size_t i(0); i < data.size(); i++) {
+            if (i % 2) {
+                set.erase(data[i]), expected.erase(data[i]);
+            } else if (auto it = set.find(data[i]); it != set.end()) {
+                auto next = expected.upper_bound(data[i]);
+                it = set.erase(it);
+                EXPECT_TRUE(next == expected.end() ? it == set.end() : *it == *next);
+                expected.erase(data[i]);
+            }
+            if (expected.size() <= 4) {
+                EXPECT_FALSE(set.is_tree());
+            }
+            check_container_equality(expected, set);
+        }
+        EXPECT_TRUE(set.empty() && !set.is_tree());
+
+        stl::SmallSet<std::string, 2> strings{"b", "a", "c", "a"};
+        EXPECT_TRUE(strings.is_tree() && strings.size() == 3 && *strings.begin() == "a");
+        stl::SmallSet<std::string, 4> few{"b", "a", "c"};
+        std::vector<std::string> reversed(few.rbegin(), few.rend());
+        EXPECT_TRUE(!few.is_tree() && reversed == std::vector<std::string>({"c", "b", "a"}));
+    }
+
+    TEST(StlSmallSet, CompareTinySetsTime) {
+        const int nb_sets = 20000;
+        for (int nb_values: {4, 12}) {
+            auto data = datagen::make_random_int_data(nb_sets * nb_values, 0, 1000);
+            size_t found_tree(0), found_small(0);
+            auto fill_and_probe = [&](auto& sets, size_t& found) {
+                for (int i(0); i < nb_sets; i++) {
+                    sets.emplace_back(data.begin() + i * nb_values, data.begin() + (i + 1) * nb_values);
+                    for (int j(0); j < nb_values; j++) {
+                        found += sets.back().contains(data[i * nb_values + j] + 1);
+                    }
+                }
+            };
+            std::vector<stl::Set<int>> tree_sets;
+            std::vector<stl::SmallSet<int>> small_sets;
+            tree_sets.reserve(nb_sets), small_sets.reserve(nb_sets);
+            std::cout << "Build and probe " << nb_sets << " sets of " << nb_values << " keys:" << std::endl;
+            std::cout << "\tSet: " << timer([&]() { fill_and_probe(tree_sets, found_tree); }) / nb_sets
+                      << "ns per set" << std::endl;
+            std::cout << "\tSmallSet: " << timer([&]() { fill_and_probe(small_sets, found_small); }) / nb_sets
+                      << "ns per set" << std::endl;
+            EXPECT_EQ(found_tree, found_small);
+        }
+    }
+
+    TEST(StlFlatSet, CheckBufferedUpdates) {
+        auto data = datagen::make_random_int_data(3000, -1000, 1000);
+        stl::FlatSet<int> set(data.begin(), data.begin() + 1000);
+        std::set<int> expected(data.begin(), data.begin() + 1000);
+        EXPECT_EQ(set.pending(), 0);
+        for (size_t i(1000); i < data.size(); i++) {
+            if (i % 3) {
+                set.insert(data[i]), expected.insert(data[i]);
+            } else {
+                set.erase(data[i - 1]), expected.erase(data[i - 1]);
+            }
+            EXPECT_EQ(set.size(), expected.size());
+            EXPECT_TRUE(set.contains(data[i]) == (expected.count(data[i]) == 1));
+            EXPECT_LE(set.pending(), std::max<size_t>(FlatSet<int>::kMinPending, 45) + 1);
+        }
+
+        std::vector<int> batch(data.begin(), data.begin() + 40);
+        set.erase_batch(batch.begin(), batch.end());
+        for (auto val: batch) {
+            expected.erase(val);
+            EXPECT_FALSE(set.contains(val));
+        }
+        batch.assign(data.begin() + 20, data.begin() + 60);
+        set.insert_batch(batch.begin(), batch.end());
+        expected.insert(batch.begin(), batch.end());
+        EXPECT_EQ(set.size(), expected.size());
+        for (int val(-1100); val < 1100; val += 7) {
+            EXPECT_EQ(set.contains(val), expected.count(val) == 1);
+        }
+
+        // const members read the buffers and never merge them
+        for (int i(0); i < 10; i++) {
+            set.insert(2000 + i), expected.insert(2000 + i);
+            auto key = *std::next(expected.begin(), i * 7);
+            set.erase(key), expected.erase(key);
+        }
+        auto pending = set.pending();
+        EXPECT_GT(pending, 0u);
+        auto first = set.begin();
+        check_container_equality(expected, set);
+        EXPECT_TRUE(std::equal(set.rbegin(), set.rend(), expected.rbegin(), expected.rend()));
+        for (int val(-1100); val < 2100; val += 3) {
+            auto it = set.lower_bound(val);
+            auto expected_it = expected.lower_bound(val);
+            EXPECT_EQ(it == set.end(), expected_it == expected.end());
+            EXPECT_TRUE(it == set.end() || *it == *expected_it);
+            EXPECT_EQ(set.find(val) != set.end(), expected.count(val) == 1);
+            it = set.upper_bound(val);
+            EXPECT_TRUE(it == set.end() ? expected.upper_bound(val) == expected.end()
+                                        : *it == *expected.upper_bound(val));
+        }
+        EXPECT_EQ(set.pending(), pending);
+        EXPECT_TRUE(first == set.begin() && *first == *expected.begin());
+
+        set.flush();
+        EXPECT_EQ(set.pending(), 0);
+        check_container_equality(expected, set);
+        EXPECT_EQ(*set.lower_bound(-2000), *expected.begin());
+        EXPECT_TRUE(set.upper_bound(*expected.rbegin()) == set.end());
+        EXPECT_TRUE(std::equal(set.rbegin(), set.rend(), expected.rbegin(), expected.rend()));
+    }
+
+    TEST(StlFlatSet, CompareLookupTime) {
+        for (int nb_values: {10000, 300000}) {
+            auto data = datagen::make_random_int_data(nb_values, 0, nb_values * 4);
+            auto keys = datagen::make_random_int_data(nb_values, 0, nb_values * 4, 7);
+            stl::Set<int> tree(data.begin(), data.end());
+            stl::FlatSet<int> flat(data.begin(), data.end());
+            size_t found_tree(0), found_flat(0);
+            auto probe = [&](auto& set, size_t& found) {
+                for (auto key: keys) {
+                    found += set.contains(key);
+                }
+            };
+
+            std::cout << "Lookup, " << nb_values << " keys:" << std::endl;
+            std::cout << "\tSet: " << timer([&]() { probe(tree, found_tree); }) / nb_values
+                      << "ns" << std::endl;
+            std::cout << "\tFlatSet: " << timer([&]() { probe(flat, found_flat); }) / nb_values
+                      << "ns" << std::endl;
+            EXPECT_EQ(found_tree, found_flat);
+
+            std::cout << "Insert " << nb_values / 10 << " keys one by one / as a batch:" << std::endl;
+            auto one_by_one = [&]() {
+                for (int i(0); i < nb_values / 10; i++) {
+                    flat.insert(keys[i]);
+                }
+            };
+            std::cout << "\tFlatSet::insert: " << timer(one_by_one) / (nb_values / 10) << "ns" << std::endl;
+            auto batch = [&]() {
+                flat.insert_batch(keys.begin() + nb_values / 10, keys.begin() + nb_values / 5);
+            };
+            std::cout << "\tFlatSet::insert_batch: " << timer(batch) / (nb_values / 10) << "ns" << std::endl;
+        }
+    }
+
+    TEST(StlSet, CheckNodeHandles) {
+        auto data = datagen::make_random_int_data(1000, -500, 500);
+        stl::Set<int> set(data.begin(), data.end());
+        std::set<int> expected(data.begin(), data.end());
+        auto first = *set.begin();
+        const int* address = &*set.begin();
+
+        auto node = set.extract(set.begin());
+        expected.erase(first);
+        EXPECT_TRUE(node && node.value() == first);
+        check_container_equality(expected, set);
+        EXPECT_TRUE(set.extract(first).empty());
+
+        node.value() = 1000;
+        auto result = set.insert(std::move(node));
+        expected.insert(1000);
+        EXPECT_TRUE(result.inserted && result.node.empty() && *result.position == 1000);
+        EXPECT_EQ(&*result.position, address);
+        check_container_equality(expected, set);
+
+        node = set.extract(*set.begin());
+        node.value() = 1000;
+        result = set.insert(std::move(node));
+        EXPECT_TRUE(!result.inserted && result.node && *result.position == 1000);
+        expected.erase(expected.begin());
+
+        auto other_data = datagen::make_random_int_data(1000, 0, 1500, 7);
+        stl::Set<int> other(other_data.begin(), other_data.end());
+        std::set<int> other_expected(other_data.begin(), other_data.end());
+        std::vector<const int*> addresses;
+        for (auto& val: other) {
+            if (!expected.count(val)) {
+                addresses.push_back(&val);
+            }
+        }
+        set.merge(other);
+        expected.merge(other_expected);
+        check_container_equality(expected, set);
+        check_container_equality(other_expected, other);
+        for (auto address: addresses) {
+            EXPECT_EQ(&*set.find(*address), address);
+        }
+
+        // a handle outlives its tree and keeps the node
+        stl::Set<int>::node_type kept, dropped;
+        {
+            stl::Set<int> source({1, 2, 3});
+            address = &*source.find(2);
+            kept = source.extract(2), dropped = source.extract(3);
+        }
+        stl::Set<int> target({5});
+        EXPECT_EQ(&*target.insert(std::move(kept)).position, address);
+        dropped.reset();
+        check_container_equality(std::set<int>({2, 5}), target);
+    }
+
+    TEST(StlRedBlackTree, CheckNodeHandles) {
+        auto data = datagen::make_random_int_data(500, 0, 50);
+        RedBlackTree<int, MultiSetTraits<int>> multi(data.begin(), data.end()), other{7, 7, 8};
+        multi.merge(other);
+        EXPECT_TRUE(other.empty() && multi.size() == data.size() + 3);
+        rbtree_verify(multi);
+
+        RedBlackTree<int, FastEraseTreeTraits<int>> fast(data.begin(), data.end());
+        std::set<int> expected(data.begin(), data.end());
+        while (!fast.empty()) {
+            auto key = fast.root()->key;
+            auto node = fast.extract(key);
+            expected.erase(key);
+            EXPECT_EQ(node.value(), key);
+            rbtree_verify(fast);
+            check_container_equality(expected, fast);
+        }
+    }
+
+    TEST(StlSet, CompareMoveKeysTime) {
+        for (int nb_values: {20000, 300000}) {
+            auto data = datagen::make_random_string_data(nb_values);
+            stl::Set<std::string> from(data.begin(), data.end()), to;
+            auto copy_keys = [&]() {
+                while (!from.empty()) {
+                    auto key = *from.begin();
+                    from.erase(key);
+                    to.insert(key);
+                }
+            };
+            auto move_nodes = [&]() {
+                while (!to.empty()) {
+                    from.insert(to.extract(to.begin()));
+                }
+            };
+            auto count = from.size();
+            std::cout << "Move " << count << " string keys to another set:" << std::endl;
+            std::cout << "\terase + insert: " << timer(copy_keys) / count << "ns" << std::endl;
+            std::cout << "\textract + insert: " << timer(move_nodes) / count << "ns" << std::endl;
+            std::cout << "\tmerge: " << timer([&]() { to.merge(from); }) / count << "ns" << std::endl;
+            EXPECT_TRUE(from.empty() && to.size() == count);
+        }
+    }
+
+    struct ThreadedTopDownTraits : ThreadedTreeTraits<int>
+    {
+        typedef TopDownRebalance rebalance;
+        static constexpr bool stable_iterators = false;
+    };
+
+    template <typename traits>
+    void check_threaded_tree()
+    {
+        auto data = datagen::make_random_int_data(2000, -1000, 1000);
+        RedBlackTree<int, traits> rb_tree;
+        std::set<int> expected;
+        auto check = [&]() {
+            check_container_equality(expected, rb_tree);
+            EXPECT_TRUE(std::equal(rb_tree.rbegin(), rb_tree.rend(), expected.rbegin(), expected.rend()));
+            if (!rb_tree.empty()) {
+                EXPECT_EQ(*--rb_tree.end(), *expected.rbegin());
+                EXPECT_EQ(*--rb_tree.rend(), *expected.begin());
+            }
+        };
+        for (size_t i(0); i < data.size(); i++) {
+            rb_tree.insert(data[i]), expected.insert(data[i]);
+            if (i % 3 == 0) {
+                rb_tree.erase(data[i / 2]), expected.erase(data[i / 2]);
+            }
+            if (i % 100 == 0) {
+                check();
+            }
+        }
+        rbtree_verify(rb_tree);
+        check();
+        for (size_t i(0); i < data.size(); i++) {
+            if (i % 2) {
+                rb_tree.extract(data[i]);
+            } else if (auto it = rb_tree.find(data[i]); it != rb_tree.end()) {
+                rb_tree.erase(it);
+            }
+            expected.erase(data[i]);
+            if (i % 100 == 0) {
+                check();
+            }
+        }
+        EXPECT_TRUE(rb_tree.empty() && rb_tree.begin() == rb_tree.end());
+        EXPECT_TRUE(rb_tree.rbegin() == rb_tree.rend());
+    }
+
+    TEST(StlRedBlackTree, CheckThreadedLinks) {
+        check_threaded_tree<TreeTraits<int>>();
+        check_threaded_tree<ThreadedTreeTraits<int>>();
+        check_threaded_tree<ThreadedTopDownTraits>();
+
+        stl::Set<int, ThreadedTreeTraits<int>> set{5, 1, 3};
+        set.clear();
+        set.insert(2);
+        EXPECT_TRUE(*set.begin() == 2 && *set.rbegin() == 2 && ++set.begin() == set.end());
+    }
+
+    TEST(StlSet, CompareIterationTime) {
+        for (int nb_values: {20000, 500000}) {
+            auto data = datagen::make_random_int_data(nb_values, 0, nb_values * 4);
+            std::set<int> std_set(data.begin(), data.end());
+            stl::Set<int> set(data.begin(), data.end());
+            stl::Set<int, ThreadedTreeTraits<int>> threaded(data.begin(), data.end());
+            long sum(0);
+            auto forward = [&](auto& container) {
+                return timer([&]() {
+                    for (auto it = container.begin(); it != container.end(); ++it) {
+                        sum += *it;
+                    }
+                });
+            };
+            auto backward = [&](auto& container) {
+                return timer([&]() {
+                    for (auto it = container.rbegin(); it != container.rend(); ++it) {
+                        sum += *it;
+                    }
+                });
+            };
+            auto count = std_set.size();
+            std::cout << "Iterate " << count << " keys, forward / backward:" << std::endl;
+            std::cout << "\tstd::set: " << forward(std_set) / count << "ns / "
+                      << backward(std_set) / count << "ns" << std::endl;
+            std::cout << "\tstl::Set: " << forward(set) / count << "ns / " << backward(set) / count << "ns"
+                      << std::endl;
+            std::cout << "\tthreaded stl::Set: " << forward(threaded) / count << "ns / "
+                      << backward(threaded) / count << "ns" << std::endl;
+            EXPECT_NE(sum, 0);
+        }
+    }
+
+    struct ThreadedTreapTraits : ThreadedTreeTraits<int>
+    {
+        typedef TreapRebalance rebalance;
+    };
+
+    struct SplaySumTraits : AggregateTraits<int, SumMonoid<int, long>>
+    {
+        typedef SplayRebalance rebalance;
+    };
+
+    struct AvlCopyKeysTraits : FastEraseTreeTraits<int>
+    {
+        typedef AvlRebalance rebalance;
+    };
+
+    // Checks links, order and header of the subtree, returns its height
+    template <typename traits>
+    int check_subtree(const RedBlackTree<int, traits>& rb_tree, const Node<int>* node)
+    {
+        if (!node) {
+            return 0;
+        }
+        EXPECT_NE(node->color, Color::Red);
+        for (auto child: {node->child[Left], node->child[Right]}) {
+            EXPECT_TRUE(!child || child->parent == node);
+        }
+        EXPECT_TRUE(!node->child[Left] || node->child[Left]->key < node->key);
+        EXPECT_TRUE(!node->child[Right] || node->key < node->child[Right]->key);
+        int lheight(check_subtree(rb_tree, node->child[Left]));
+        int rheight(check_subtree(rb_tree, node->child[Right]));
+        if constexpr (std::is_same_v<typename traits::rebalance, AvlRebalance>) {
+            EXPECT_LE(std::abs(lheight - rheight), 1);
+            EXPECT_EQ(int(node->color), 1 + std::max(lheight, rheight));
+        }
+        return 1 + std::max(lheight, rheight);
+    }
+
+    template <typename traits>
+    void check_balancing_policy()
+    {
+        auto data = datagen::make_random_int_data(3000, -2000, 2000);
+        RedBlackTree<int, traits> rb_tree;
+        std::set<int> expected;
+        auto check = [&]() {
+            check_container_equality(expected, rb_tree);
+            EXPECT_TRUE(std::equal(rb_tree.rbegin(), rb_tree.rend(), expected.rbegin(), expected.rend()));
+            if (!rb_tree.empty()) {
+                EXPECT_TRUE(is_header(rb_tree.root()->parent));
+                EXPECT_EQ(rb_tree.leftmost(), rb_tree.minimum(rb_tree.root()));
+                EXPECT_EQ(rb_tree.rightmost(), rb_tree.maximum(rb_tree.root()));
+            }
+            int height = check_subtree(rb_tree, rb_tree.root());
+            if constexpr (!std::is_same_v<typename traits::rebalance, SplayRebalance>) {
+                EXPECT_LE(height, 4 * std::log2(rb_tree.size() + 1) + 1);
+            }
+        };
+        for (size_t i(0); i < data.size(); i++) {
+            rb_tree.insert(data[i]), expected.insert(data[i]);
+            if (i % 3 == 0) {
+                rb_tree.erase(data[i / 2]), expected.erase(data[i / 2]);
+            }
+            if (i % 250 == 0) {
+                check();
+            }
+        }
+        check();
+        for (size_t i(0); i < data.size(); i += 7) {
+            auto it = rb_tree.find(data[i]);
+            EXPECT_EQ(it != rb_tree.end(), expected.count(data[i]) == 1);
+            if (std::is_same_v<typename traits::rebalance, SplayRebalance> && it != rb_tree.end()) {
+                EXPECT_EQ(rb_tree.root(), it.node);
+            }
+        }
+        check();
+        for (size_t i(0); i < data.size(); i++) {
+            if (i % 2) {
+                rb_tree.extract(data[i]);
+            } else if (auto it = rb_tree.find(data[i]); it != rb_tree.end()) {
+                rb_tree.erase(it);
+            }
+            expected.erase(data[i]);
+            if (i % 250 == 0) {
+                check();
+            }
+        }
+        EXPECT_TRUE(rb_tree.empty() && rb_tree.begin() == rb_tree.end());
+    }
+
+    TEST(StlRedBlackTree, CheckBalancingPolicies) {
+        check_balancing_policy<AvlTreeTraits<int>>();
+        check_balancing_policy<AvlCopyKeysTraits>();
+        check_balancing_policy<TreapTreeTraits<int>>();
+        check_balancing_policy<ThreadedTreapTraits>();
+        check_balancing_policy<SplayTreeTraits<int>>();
+        check_balancing_policy<SplaySumTraits>();
+
+        // ascending and descending keys make a path of a splay tree
+        std::vector<int> ascending(100000);
+        std::iota(ascending.begin(), ascending.end(), 0);
+        stl::Set<int, SplayTreeTraits<int>> splay(ascending.rbegin(), ascending.rend());
+        long sum(0);
+        splay.for_each_range(10, 20, [&](int key) { sum += key; }, Bounds::Closed);
+        EXPECT_EQ(sum, 165);
+        splay.clear();
+
+        RedBlackTree<int, SplaySumTraits> sums(ascending.begin(), ascending.end());
+        EXPECT_EQ(sums.aggregate(100, 199, Bounds::Closed), 14950);
+        sums.find(150);
+        sums.erase(120);
+        EXPECT_EQ(sums.aggregate(100, 199, Bounds::Closed), 14830);
+
+        stl::Set<int, AvlTreeTraits<int>> avl(ascending.begin(), ascending.end());
+        EXPECT_TRUE(std::equal(avl.begin(), avl.end(), ascending.begin(), ascending.end()));
+        stl::Set<int, TreapTreeTraits<int>> treap(ascending.begin(), ascending.begin() + 500);
+        stl::Set<int, TreapTreeTraits<int>> rest(ascending.begin() + 250, ascending.end());
+        treap.merge(rest);
+        EXPECT_TRUE(rest.size() == 250 && treap.size() == ascending.size());
+        EXPECT_TRUE(std::equal(treap.begin(), treap.end(), ascending.begin(), ascending.end()));
+    }
+
+    TEST(StlSet, CompareBalancingTime) {
+        int nb_values(200000), nb_lookups(1000000);
+        auto random = datagen::make_random_int_data(nb_values, 0, nb_values * 4);
+        std::vector<int> keys(random), ascending(nb_values);
+        std::sort(keys.begin(), keys.end());
+        keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+        std::iota(ascending.begin(), ascending.end(), 0);
+        // hot keys are spread over the whole key range
+        auto ranked = keys;
+        std::shuffle(ranked.begin(), ranked.end(), std::default_random_engine());
+        std::vector<int> uniform, zipf;
+        for (auto index: datagen::make_random_int_data(nb_lookups, 0, keys.size() - 1)) {
+            uniform.push_back(keys[index]);
+        }
+        for (auto rank: datagen::make_zipf_rank_data(nb_lookups, keys.size(), 1.0)) {
+            zipf.push_back(ranked[rank]);
+        }
+
+        std::cout << "Balancing policies, " << keys.size() << " keys, ns per operation:" << std::endl;
+        std::cout << "\t" << std::setw(10) << "" << std::setw(16) << "random insert" << std::setw(16)
+                  << "sorted insert" << std::setw(16) << "uniform find" << std::setw(16) << "zipf find"
+                  << std::setw(16) << "erase" << std::endl;
+        size_t found(0);
+        auto measure = [&](const char* name, auto set) {
+            auto sorted = set;
+            auto lookup = [&](const std::vector<int>& data) {
+                return timer([&]() {
+                    for (auto key: data) {
+                        found += set.find(key) != set.end();
+                    }
+                }) / nb_lookups;
+            };
+            std::cout << "\t" << std::setw(10) << name
+                      << std::setw(16) << timer([&]() { insert_data(set, random); }) / nb_values
+                      << std::setw(16) << timer([&]() { insert_data(sorted, ascending); }) / nb_values
+                      << std::setw(16) << lookup(uniform)
+                      << std::setw(16) << lookup(zipf)
+                      << std::setw(16) << timer([&]() { erase_data(set, random); }) / nb_values
+                      << std::endl;
+            EXPECT_TRUE(set.empty());
+        };
+        measure("std::set", std::set<int>());
+        measure("red-black", stl::Set<int>());
+        measure("AVL", stl::Set<int, AvlTreeTraits<int>>());
+        measure("treap", stl::Set<int, TreapTreeTraits<int>>());
+        measure("splay", stl::Set<int, SplayTreeTraits<int>>());
+        EXPECT_EQ(found, 5 * 2 * size_t(nb_lookups));
+    }
+
+    template <typename traits>
+    void check_lookup_cache()
+    {
+        auto data = datagen::make_random_int_data(5000, 0, 2000);
+        std::set<int> set(data.begin(), data.end());
+        stl::Set<int, traits> stlset(data.begin(), data.end());
+        stlset.enable_cache(64);
+        auto check = [&]() {
+            for (int val(0); val <= 2000; val++) {
+                auto it = stlset.find_cached(val);
+                EXPECT_EQ(set.count(val) != 0, it != stlset.end());
+                EXPECT_TRUE(it == stlset.end() || *it == val);
+                EXPECT_EQ(stlset.find(val), it);
+            }
+        };
+        check();
+        for (int i(0); i < 100; i++) {
+            EXPECT_TRUE(stlset.find_cached(data[i % 4]) != stlset.end());
+        }
+        EXPECT_GE(stlset.cache_stats().hits, 96u);
+
+        // erasing a key with two children may free the node of the next key
+        for (size_t i(0); i < data.size(); i += 3) {
+            set.erase(data[i]), stlset.erase(data[i]);
+            EXPECT_FALSE(stlset.contains(data[i]));
+        }
+        check();
+        for (auto it = stlset.begin(); it != stlset.end(); ) {
+            set.erase(*it);
+            it = stlset.erase(it);
+            if (it != stlset.end()) {
+                ++it;
+            }
+        }
+        check();
+        auto handle = stlset.extract(*stlset.begin());
+        set.erase(handle.value());
+        check();
+        for (int val(0); val <= 2000; val += 2) {
+            set.insert(val), stlset.insert(val);
+        }
+        check();
+        check_container_equality(set, stlset);
+
+        auto copy(stlset);
+        stl::Set<int, traits> other;
+        other.merge(copy);
+        EXPECT_TRUE(copy.empty() && !copy.contains(0));
+        EXPECT_EQ(copy.cache_stats().capacity, 64u);
+
+        auto stats = stlset.cache_stats();
+        EXPECT_GT(stats.invalidations, 0u);
+        EXPECT_LE(stats.hits, stats.lookups);
+        EXPECT_EQ(stats.memory_bytes, 64u * 16);
+        stlset.clear();
+        EXPECT_FALSE(stlset.contains(0));
+        stlset.disable_cache();
+        EXPECT_EQ(stlset.cache_stats().lookups, 0u);
+    }
+
+    TEST(StlSet, CheckLookupCache) {
+        check_lookup_cache<TreeTraits<int>>();
+        check_lookup_cache<FastEraseTreeTraits<int>>();
+        check_lookup_cache<TopDownTreeTraits<int>>();
+
+        stl::Set<int> stlset{1, 2, 3};
+        stlset.enable_filter();
+        stlset.enable_cache();
+        EXPECT_TRUE(stlset.contains(2) && stlset.contains(2) && !stlset.contains(4));
+        EXPECT_EQ(stlset.cache_stats().hits, 0u);
+        EXPECT_TRUE(stlset.find_cached(2) != stlset.end() && stlset.contains(2));
+        EXPECT_TRUE(stlset.find_cached(4) == stlset.end());
+        EXPECT_EQ(stlset.cache_stats().hits, 1u);
+
+        // const lookups read the cache without reordering it
+        auto data = datagen::make_random_int_data(20000, 0, 10000);
+        stl::Set<int> hot(data.begin(), data.end());
+        hot.enable_cache(256);
+        for (int val(0); val < 1000; val++) {
+            hot.find_cached(val);
+        }
+        const auto& readers = hot;
+        std::vector<std::thread> threads;
+        std::atomic<size_t> found(0);
+        for (int thread(0); thread < 4; thread++) {
+            threads.emplace_back([&]() {
+                for (int val(0); val < 1000; val++) {
+                    auto it = readers.find(val);
+                    found += it != readers.end() && *it == val;
+                }
+            });
+        }
+        for (auto& thread: threads) {
+            thread.join();
+        }
+        EXPECT_EQ(found, 4 * size_t(std::distance(hot.begin(), hot.lower_bound(1000))));
+        EXPECT_EQ(hot.cache_stats().lookups, 1000u + 4 * 1000);
+
+        // a copy gets an empty cache of the same capacity, not the nodes of hot
+        auto copy(hot);
+        EXPECT_EQ(copy.cache_stats().capacity, hot.cache_stats().capacity);
+        EXPECT_EQ(*copy.find_cached(data[0]), data[0]);
+        EXPECT_EQ(copy.cache_stats().hits, 0u);
+        copy = stlset;
+        EXPECT_TRUE(copy.find_cached(2) != copy.end() && copy.cache_stats().hits == 0);
+        stl::Set<int> uncached;
+        copy = uncached;
+        EXPECT_EQ(copy.cache_stats().capacity, 0u);
+    }
+
+    TEST(StlSet, CompareHotKeyLookupTime) {
+        int nb_values(200000), nb_lookups(1000000);
+        auto data = datagen::make_random_int_data(nb_values, 0, nb_values * 4);
+        std::vector<int> keys(data);
+        std::sort(keys.begin(), keys.end());
+        keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+        std::shuffle(keys.begin(), keys.end(), std::default_random_engine());
+        stl::Set<int> plain(data.begin(), data.end());
+        stl::Set<int> cached(data.begin(), data.end());
+        cached.enable_cache(4096);
+
+        for (double skew: {0.8, 1.0, 1.2}) {
+            std::vector<int> lookups;
+            for (auto rank: datagen::make_zipf_rank_data(nb_lookups, keys.size(), skew)) {
+                lookups.push_back(keys[rank]);
+            }
+            size_t found(0);
+            auto lookup = [&](stl::Set<int>& set) {
+                return timer([&]() {
+                    for (auto key: lookups) {
+                        found += set.find_cached(key) != set.end();
+                    }
+                }) / nb_lookups;
+            };
+            auto before = cached.cache_stats();
+            std::cout << "Find of Zipf(" << skew << ") keys, " << keys.size() << " keys:" << std::endl;
+            std::cout << "\tstl::Set: " << lookup(plain) << "ns" << std::endl;
+            std::cout << "\tcached stl::Set: " << lookup(cached) << "ns" << std::endl;
+            auto after = cached.cache_stats();
+            auto hits = after.hits - before.hits, cache_lookups = after.lookups - before.lookups;
+            std::cout << "\tcache hit rate: " << double(hits) / cache_lookups << std::endl;
+            EXPECT_EQ(found, 2 * size_t(nb_lookups));
+        }
+    }
+
+    template <typename traits>
+    void check_hashed_set()
+    {
+        auto data = datagen::make_random_int_data(20000, -5000, 5000);
+        std::set<int> set;
+        stl::HashedSet<int, traits> hashed;
+        for (size_t i(0); i < data.size(); i++) {
+            set.insert(data[i]), hashed.insert(data[i]);
+            if (i % 3 == 0) {
+                set.erase(data[i / 2]), hashed.erase(data[i / 2]);
+            }
+        }
+        check_container_equality(set, hashed);
+        auto check = [&]() {
+            for (int val(-5001); val <= 5001; val++) {
+                auto it = hashed.find(val);
+                EXPECT_EQ(set.count(val) != 0, hashed.contains(val));
+                EXPECT_TRUE(it == hashed.end() ? !set.count(val) : *it == val);
+            }
+        };
+        check();
+
+        // erasing a key with two children may move the next key to its node
+        for (auto it = hashed.begin(); it != hashed.end(); ) {
+            set.erase(*it);
+            it = hashed.erase(it);
+            if (it != hashed.end()) {
+                ++it;
+            }
+        }
+        check();
+        EXPECT_EQ(*hashed.lower_bound(0), *set.lower_bound(0));
+        EXPECT_EQ(*hashed.upper_bound(0), *set.upper_bound(0));
+        EXPECT_TRUE(std::equal(hashed.rbegin(), hashed.rend(), set.rbegin(), set.rend()));
+
+        auto copy(hashed);
+        hashed.clear();
+        EXPECT_TRUE(hashed.empty() && !hashed.contains(*set.begin()));
+        for (auto& val: set) {
+            EXPECT_TRUE(copy.contains(val));
+        }
+        hashed = copy;
+        copy.clear();
+        check();
+    }
+
+    TEST(StlHashedSet, CheckAgainstSet) {
+        check_hashed_set<TreeTraits<int>>();
+        check_hashed_set<FastEraseTreeTraits<int>>();
+
+        stl::HashedSet<std::string> strings{"b", "a", "c", "a"};
+        EXPECT_EQ(strings.size(), 3u);
+        EXPECT_TRUE(strings.contains("a") && !strings.contains("d"));
+        EXPECT_EQ(*strings.begin(), "a");
+        EXPECT_GT(strings.index_memory_usage(), 0u);
+
+        // erasing most keys shrinks the index back
+        std::vector<int> keys(100000);
+        std::iota(keys.begin(), keys.end(), 0);
+        stl::HashedSet<int> shrinking(keys.begin(), keys.end());
+        size_t peak = shrinking.index_memory_usage();
+        for (int val(10); val < 100000; val++) {
+            shrinking.erase(val);
+        }
+        EXPECT_EQ(shrinking.size(), 10u);
+        EXPECT_LE(shrinking.index_memory_usage() * 1000, peak);
+        for (int val(0); val < 100000; val++) {
+            EXPECT_EQ(shrinking.contains(val), val < 10);
+        }
+    }
+
+    TEST(StlHashedSet, CompareLookupTime) {
+        for (int nb_values: {20000, 500000}) {
+            auto data = datagen::make_random_int_data(nb_values, 0, nb_values * 4);
+            auto lookups = datagen::make_random_int_data(nb_values, 0, nb_values * 4, 7);
+            std::unordered_set<int> unordered(data.begin(), data.end());
+            stl::Set<int> set(data.begin(), data.end());
+            stl::HashedSet<int> hashed(data.begin(), data.end());
+            size_t found(0);
+            auto lookup = [&](const auto& container) {
+                found = 0;
+                return timer([&]() {
+                    for (auto key: lookups) {
+                        found += container.find(key) != container.end();
+                    }
+                }) / nb_values;
+            };
+            std::cout << "Find operation, " << hashed.size() << " keys:" << std::endl;
+            std::cout << "\tstd::unordered_set: " << lookup(unordered) << "ns" << std::endl;
+            auto expected_found = found;
+            std::cout << "\tstl::Set: " << lookup(set) << "ns" << std::endl;
+            EXPECT_EQ(found, expected_found);
+            std::cout << "\tstl::HashedSet: " << lookup(hashed) << "ns" << std::endl;
+            EXPECT_EQ(found, expected_found);
+            std::cout << "\tindex: " << double(hashed.index_memory_usage()) / hashed.size()
+                      << " bytes per key" << std::endl;
+        }
+    }
+
+    TEST(StlSet, CheckParallelScan) {
+        auto data = datagen::make_random_int_data(60000, -100000, 100000);
+        stl::Set<int> set(data.begin(), data.end());
+        std::set<int> expected(data.begin(), data.end());
+        auto square = [](int key) { return int64_t(key) * key; };
+        auto plus = [](int64_t left, int64_t right) { return left + right; };
+        auto concat = [](std::string left, const std::string& right) { return left + right; };
+        auto to_string = [](int key) { return std::to_string(key) + ","; };
+
+        int64_t sum_of_squares(0);
+        std::string keys;
+        for (auto key: expected) {
+            sum_of_squares += square(key);
+            keys += std::to_string(key) + ",";
+        }
+        for (size_t threads: {0, 1, 2, 3, 8}) {
+            execution::parallel_policy par{threads};
+            std::atomic<int64_t> sum(0);
+            std::atomic<size_t> count(0);
+            stl::for_each(par, set, [&](int key) { sum += square(key), count++; });
+            EXPECT_EQ(sum, sum_of_squares);
+            EXPECT_EQ(count, expected.size());
+            EXPECT_EQ(stl::transform_reduce(par, set, int64_t(0), plus, square), sum_of_squares);
+            // string concatenation does not commute
+            EXPECT_EQ(stl::transform_reduce(par, set, std::string(), concat, to_string), keys);
+        }
+        EXPECT_EQ(stl::transform_reduce(execution::seq, set, std::string(), concat, to_string), keys);
+
+        for (auto bounds: {Bounds::Closed, Bounds::Open, Bounds::LeftOpen, Bounds::RightOpen}) {
+            for (auto [lo, hi]: {std::pair(-50000, 70000), std::pair(data[0], data[1]), std::pair(5, 5)}) {
+                int64_t expected_sum(0);
+                set.for_each_range(lo, hi, [&](int key) { expected_sum += square(key); }, bounds);
+                std::atomic<int64_t> sum(0);
+                stl::for_each(execution::par, set, lo, hi, [&](int key) { sum += square(key); }, bounds);
+                EXPECT_EQ(sum, expected_sum);
+                for (auto policy: {execution::parallel_policy{1}, execution::parallel_policy{4}}) {
+                    EXPECT_EQ(stl::transform_reduce(policy, set, lo, hi, int64_t(7), plus, square, bounds),
+                              expected_sum + 7);
+                }
+                auto seq = execution::seq;
+                EXPECT_EQ(stl::transform_reduce(seq, set, lo, hi, int64_t(7), plus, square, bounds),
+                          expected_sum + 7);
+
+                std::vector<stl::Set<int>::iterator> points;
+                set.split_points(lo, hi, 6, std::back_inserter(points), bounds);
+                auto range = set.range(lo, hi, bounds);
+                std::set<int> inside(range.begin(), range.end());
+                EXPECT_LE(points.size(), 63u);
+                for (size_t i(0); i < points.size(); i++) {
+                    EXPECT_TRUE(inside.count(*points[i]));
+                    EXPECT_TRUE(!i || *points[i - 1] < *points[i]);
+                }
+            }
+        }
+
+        // ascending inserts leave a splay tree a path, its pieces are cut by count
+        stl::Set<int, SplayTreeTraits<int>> splay;
+        for (auto key: expected) {
+            splay.insert(key);
+        }
+        std::vector<stl::Set<int, SplayTreeTraits<int>>::iterator> points;
+        splay.split_points(*expected.begin(), *expected.rbegin(), 6, std::back_inserter(points));
+        EXPECT_EQ(points.size(), 63u);
+        auto step = (expected.size() + 63) / 64;
+        for (size_t i(0); i < points.size(); i++) {
+            EXPECT_EQ(size_t(std::distance(splay.begin(), points[i])), (i + 1) * step);
+        }
+        for (size_t threads: {1, 4}) {
+            execution::parallel_policy par{threads};
+            EXPECT_EQ(stl::transform_reduce(par, splay, int64_t(0), plus, square), sum_of_squares);
+            EXPECT_EQ(stl::transform_reduce(par, splay, std::string(), concat, to_string), keys);
+        }
+
+        stl::Set<int> empty;
+        EXPECT_EQ(stl::transform_reduce(execution::par, empty, 3, std::plus<int>(), square), 3);
+        EXPECT_THROW(stl::for_each(execution::par, set, [](int key) {
+            if (key > 0) {
+                throw std::runtime_error("stop");
+            }
+        }), std::runtime_error);
+    }
+
+    TEST(StlSet, CompareParallelScanTime) {
+        int nb_values(1000000);
+        auto data = datagen::make_random_int_data(nb_values, 0, nb_values * 4);
+        stl::Set<int> set(data.begin(), data.end());
+        auto plus = [](int64_t left, int64_t right) { return left + right; };
+        auto identity = [](int key) { return int64_t(key); };
+        int64_t sum(0);
+        std::cout << "Sum of " << set.size() << " keys, "
+                  << std::thread::hardware_concurrency() << " hardware threads:" << std::endl;
+        std::cout << "\tfor (key: set): " << timer([&]() {
+            for (auto key: set) {
+                sum += key;
+            }
+        }) / set.size() << "ns" << std::endl;
+        std::cout << "\ttransform_reduce(seq): " << timer([&]() {
+            sum -= stl::transform_reduce(execution::seq, set, int64_t(0), plus, identity);
+        }) / set.size() << "ns" << std::endl;
+        EXPECT_EQ(sum, 0);
+        for (size_t threads: {2, 4, 0}) {
+            execution::parallel_policy par{threads};
+            std::cout << "\ttransform_reduce(par, " << (threads ? std::to_string(threads) : "all")
+                      << " threads): " << timer([&]() {
+                sum += stl::transform_reduce(par, set, int64_t(0), plus, identity);
+            }) / set.size() << "ns" << std::endl;
+        }
+        EXPECT_EQ(sum, 3 * std::accumulate(set.begin(), set.end(), int64_t(0)));
+    }
+
+    template <typename key_type, typename make_key>
+    void check_string_keys(const std::vector<std::string>& data, make_key make)
+    {
+        std::set<std::string> expected;
+        stl::Set<key_type> set;
+        for (size_t i(0); i < data.size(); i++) {
+            expected.insert(data[i]), set.insert(make(data[i]));
+            if (i % 3 == 0) {
+                expected.erase(data[i / 2]), set.erase(make(data[i / 2]));
+            }
+        }
+        EXPECT_EQ(set.size(), expected.size());
+        auto same = [&](const key_type& key, const std::string& str) { return key == make(str); };
+        EXPECT_TRUE(std::equal(set.begin(), set.end(), expected.begin(), expected.end(), same));
+        for (auto& str: data) {
+            EXPECT_EQ(set.contains(make(str)), expected.count(str) != 0);
+            auto it = set.lower_bound(make(str + '\x01'));
+            auto expected_it = expected.lower_bound(str + '\x01');
+            EXPECT_TRUE(it == set.end() ? expected_it == expected.end() : *it == make(*expected_it));
+        }
+    }
+
+    TEST(StlSet, CheckStringKeys) {
+        // short strings over a few bytes, including zero and negative chars, tie often
+        std::mt19937 gen(42);
+        std::vector<std::string> data;
+        const char alphabet[] = {'\0', 'a', 'b', '\x7f', '\x80', '\xff'};
+        for (int i(0); i < 5000; i++) {
+            std::string str(gen() % 20, '\0');
+            for (auto& c: str) {
+                c = alphabet[gen() % sizeof(alphabet)];
+            }
+            data.push_back(str);
+        }
+
+        EXPECT_EQ(key_prefix("ab"), 0x6162000000000000ULL);
+        EXPECT_EQ(key_prefix("abcdefghij"), 0x6162636465666768ULL);
+        EXPECT_TRUE(PrefixString("ab") < PrefixString(std::string("ab\0", 3)));
+        EXPECT_TRUE(PrefixString("\x7f") < PrefixString("\x80"));
+        EXPECT_TRUE(PrefixString("abcdefgh1") < PrefixString("abcdefgh2"));
+        EXPECT_FALSE(PrefixString("abcdefgh2") < PrefixString("abcdefgh1"));
+
+        check_string_keys<PrefixString>(data, [](const std::string& str) { return PrefixString(str); });
+        StringArena arena;
+        check_string_keys<ArenaString>(data, [&](const std::string& str) { return arena.add(str); });
+        EXPECT_GT(arena.memory_usage(), 0u);
+        arena.clear();
+        EXPECT_EQ(arena.memory_usage(), 0u);
+
+        // lookups by a view of a string do not copy it into the arena
+        std::string huge(StringArena::kChunkSize, 'x');
+        stl::Set<ArenaString> set{arena.add("apple"), arena.add(huge)};
+        auto memory = arena.memory_usage();
+        std::string apple("apple");
+        EXPECT_TRUE(set.contains(ArenaString(apple)) && !set.contains(ArenaString("pear")));
+        EXPECT_TRUE(set.contains(ArenaString(huge)));
+        EXPECT_EQ(arena.memory_usage(), memory);
+        EXPECT_EQ(set.begin()->view(), "apple");
+        EXPECT_EQ(std::hash<ArenaString>()(*set.begin()), std::hash<std::string>()(apple));
+
+        // a moved-from arena starts over and leaves the chunks of the target alone
+        StringArena target(std::move(arena));
+        EXPECT_EQ(arena.memory_usage(), 0u);
+        EXPECT_EQ(target.memory_usage(), memory);
+        arena.add("pear");
+        EXPECT_EQ(set.begin()->view(), "apple");
+        arena = std::move(target);
+        EXPECT_EQ(target.memory_usage(), 0u);
+        target.add("plum");
+        EXPECT_EQ(set.begin()->view(), "apple");
+        EXPECT_TRUE(set.contains(ArenaString(huge)));
+    }
+
+    TEST(StlSet, CompareStringKeysTime) {
+        int nb_values(200000);
+        std::mt19937 gen(42);
+        auto random_string = [&](size_t size) {
+            std::string str(size, 'a');
+            for (auto& c: str) {
+                c = 'a' + gen() % 26;
+            }
+            return str;
+        };
+        std::vector<std::string> words, urls;
+        for (int i(0); i < nb_values; i++) {
+            words.push_back(random_string(24 + gen() % 40));
+            // keys sharing their first 8 bytes need the full comparison
+            urls.push_back("https://example.com/" + random_string(24));
+        }
+        for (auto data: {&words, &urls}) {
+            auto lookups = *data;
+            std::shuffle(lookups.begin(), lookups.end(), gen);
+            stl::Set<std::string> strings(data->begin(), data->end());
+            std::vector<PrefixString> prefixed_keys(data->begin(), data->end());
+            stl::Set<PrefixString> prefixed(prefixed_keys.begin(), prefixed_keys.end());
+            StringArena arena;
+            stl::Set<ArenaString> arena_keys;
+            for (auto& str: *data) {
+                arena_keys.insert(arena.add(str));
+            }
+            size_t found(0);
+            std::cout << "Find operation, " << (data == &words ? "random words" : "urls with a common prefix")
+                      << ":" << std::endl;
+            std::cout << "\tstl::Set<std::string>: " << timer([&]() {
+                for (auto& str: lookups) {
+                    found += strings.contains(str);
+                }
+            }) / nb_values << "ns" << std::endl;
+            std::vector<PrefixString> prefixed_lookups(lookups.begin(), lookups.end());
+            std::cout << "\tstl::Set<PrefixString>: " << timer([&]() {
+                for (auto& key: prefixed_lookups) {
+                    found += prefixed.contains(key);
+                }
+            }) / nb_values << "ns" << std::endl;
+            std::cout << "\tstl::Set<ArenaString>: " << timer([&]() {
+                for (auto& str: lookups) {
+                    found += arena_keys.contains(ArenaString(str));
+                }
+            }) / nb_values << "ns" << std::endl;
+            EXPECT_EQ(found, 3 * lookups.size());
+        }
+    }
+
+    // String key counting the comparisons made through it
+    struct CountedString
+    {
+        std::string str;
+        static inline size_t comparisons = 0;
+
+        bool operator<(const CountedString& other) const
+        {
+            comparisons++;
+            return str < other.str;
+        }
+
+        int compare(const CountedString& other) const
+        {
+            comparisons++;
+            return str.compare(other.str);
+        }
+    };
+
+    template <typename key_type>
+    struct LessOnlyTraits : TreeTraits<key_type>
+    {
+        static constexpr bool three_way_compare = false;
+    };
+
+    struct CountedCompareTraits : TreeTraits<int>
+    {
+        static inline size_t calls = 0;
+
+        static int compare(int left, int right)
+        {
+            calls++;
+            return left < right ? -1 : left > right;
+        }
+    };
+
+    template <typename traits>
+    size_t count_find_comparisons(const std::vector<CountedString>& keys)
+    {
+        stl::Set<CountedString, traits> set(keys.begin(), keys.end());
+        CountedString::comparisons = 0;
+        for (auto& key: keys) {
+            EXPECT_TRUE(set.find(key) != set.end());
+        }
+        return CountedString::comparisons;
+    }
+
+    template <typename traits>
+    void check_three_way(const std::vector<CountedString>& keys)
+    {
+        std::set<std::string> expected;
+        stl::Set<CountedString, traits> set;
+        for (size_t i(0); i < keys.size(); i++) {
+            expected.insert(keys[i].str), set.insert(keys[i]);
+            if (i % 3 == 0) {
+                expected.erase(keys[i / 2].str), set.erase(keys[i / 2]);
+            }
+        }
+        auto same = [](const CountedString& key, const std::string& str) { return key.str == str; };
+        EXPECT_TRUE(std::equal(set.begin(), set.end(), expected.begin(), expected.end(), same));
+
+        std::vector<typename stl::Set<CountedString, traits>::iterator> found;
+        set.find_many(keys, std::back_inserter(found));
+        for (size_t i(0); i < keys.size(); i++) {
+            EXPECT_EQ(found[i] != set.end(), expected.count(keys[i].str) != 0);
+        }
+
+        stl::MultiSet<CountedString> multi(keys.begin(), keys.end());
+        for (size_t i(0); i < keys.size(); i += 7) {
+            auto [first, last] = multi.equal_range(keys[i]);
+            EXPECT_EQ(size_t(std::distance(first, last)), size_t(std::count_if(keys.begin(), keys.end(),
+                [&](const CountedString& key) { return key.str == keys[i].str; })));
+        }
+    }
+
+    // compare() here is an equality test, a tree must keep using operator<
+    struct EqualityComparedKey
+    {
+        int value;
+
+        bool compare(const EqualityComparedKey& other) const
+        {
+            return value == other.value;
+        }
+
+        friend bool operator<(const EqualityComparedKey& left, const EqualityComparedKey& right)
+        {
+            return left.value < right.value;
+        }
+    };
+
+    TEST(StlSet, CheckThreeWayCompare) {
+        static_assert(has_member_compare<std::string>::value && has_member_compare<PrefixString>::value);
+        static_assert(!has_member_compare<int>::value && has_traits_compare<CountedCompareTraits>::value);
+        static_assert(!has_member_compare<EqualityComparedKey>::value);
+        stl::Set<EqualityComparedKey> equality_compared;
+        for (int val: {5, 1, 9, 3, 7}) {
+            equality_compared.insert(EqualityComparedKey{val});
+        }
+        EXPECT_TRUE(equality_compared.contains(EqualityComparedKey{3}));
+        EXPECT_FALSE(equality_compared.contains(EqualityComparedKey{4}));
+        EXPECT_EQ(equality_compared.begin()->value, 1);
+        EXPECT_EQ(compare_keys<TreeTraits<std::string>>("a", "b"), -1);
+        EXPECT_EQ(compare_keys<TreeTraits<std::string>>("ab", "a"), 1);
+        EXPECT_EQ(compare_keys<TreeTraits<int>>(3, 3), 0);
+
+        std::vector<CountedString> keys;
+        for (auto& str: datagen::make_random_string_data(5000)) {
+            keys.push_back(CountedString{str});
+        }
+        auto three_way = count_find_comparisons<TreeTraits<CountedString>>(keys);
+        auto less_only = count_find_comparisons<LessOnlyTraits<CountedString>>(keys);
+        EXPECT_LT(three_way * 4, less_only * 3);
+
+        check_three_way<TreeTraits<CountedString>>(keys);
+        check_three_way<TopDownTreeTraits<CountedString>>(keys);
+
+        auto data = datagen::make_random_int_data(5000, -1000, 1000);
+        stl::Set<int, CountedCompareTraits> set(data.begin(), data.end());
+        std::set<int> expected(data.begin(), data.end());
+        check_container_equality(set, expected);
+        for (int val(-1001); val <= 1001; val++) {
+            EXPECT_EQ(set.contains(val), expected.count(val) != 0);
+        }
+        EXPECT_GT(CountedCompareTraits::calls, 0u);
+    }
+
+    TEST(StlSet, CompareThreeWayTime) {
+        std::mt19937 gen(42);
+        for (int nb_values: {2000, 200000}) {
+            std::vector<std::string> urls;
+            for (int i(0); i < nb_values; i++) {
+                std::string path(24, 'a');
+                for (auto& c: path) {
+                    c = 'a' + gen() % 26;
+                }
+                urls.push_back("https://example.com/" + path);
+            }
+            std::vector<CountedString> counted;
+            for (auto& url: urls) {
+                counted.push_back(CountedString{url});
+            }
+            // the same number of lookups for both sizes
+            std::vector<std::string> lookups;
+            while (lookups.size() < 200000) {
+                lookups.insert(lookups.end(), urls.begin(), urls.end());
+            }
+            std::shuffle(lookups.begin(), lookups.end(), gen);
+            auto find_time = [&](const auto& set) {
+                size_t found(0);
+                auto duration = timer([&]() {
+                    for (auto& key: lookups) {
+                        found += set.contains(key);
+                    }
+                }) / lookups.size();
+                EXPECT_EQ(found, lookups.size());
+                return duration;
+            };
+            std::cout << "Find operation, " << nb_values << " urls with a common prefix:" << std::endl;
+            stl::Set<std::string, LessOnlyTraits<std::string>> less_only(urls.begin(), urls.end());
+            stl::Set<std::string> three_way(urls.begin(), urls.end());
+            std::cout << "\toperator<: " << find_time(less_only) << "ns, "
+                      << double(count_find_comparisons<LessOnlyTraits<CountedString>>(counted)) / nb_values
+                      << " comparisons" << std::endl;
+            std::cout << "\tcompare(): " << find_time(three_way) << "ns, "
+                      << double(count_find_comparisons<TreeTraits<CountedString>>(counted)) / nb_values
+                      << " comparisons" << std::endl;
+        }
+    }
+
+    TEST(StlRedBlackTree, CompareDescentTime) {
+        // the descent of lower_bound as it was written before nodes indexed their children
+        auto branchy_lower_bound = [](const RedBlackTree<int>& rb_tree, int val) {
+            auto node = rb_tree.root();
+            auto result = rb_tree.end().node;
+            while (node) {
+                if (!(node->key < val)) {
+                    result = node, node = node->child[Left];
+                } else {
+                    node = node->child[Right];
+                }
+            }
+            return result;
+        };
+        // the conditional-move descent without prefetching the children
+        auto cmov_lower_bound = [](const RedBlackTree<int>& rb_tree, int val) {
+            auto node = rb_tree.root();
+            auto result = rb_tree.end().node;
+            while (node) {
+                bool right = node->key < val;
+                result = right ? result : node;
+                node = node->child[right];
+            }
+            return result;
+        };
+        PerfCounter branch_misses(PerfCounter::Event::BranchMisses);
+        for (int nb_values: {1000, 1000000}) {
+            auto data = datagen::make_random_int_data(nb_values, 0, nb_values * 4);
+            auto lookups = datagen::make_random_int_data(1000000, 0, nb_values * 4, 7);
+            RedBlackTree<int> rb_tree(data.begin(), data.end());
+            auto measure = [&](const char* name, const auto& lower_bound) {
+                size_t found(0);
+                branch_misses.start();
+                auto duration = timer([&]() {
+                    for (auto val: lookups) {
+                        found += lower_bound(val) != rb_tree.end().node;
+                    }
+                }) / lookups.size();
+                auto misses = branch_misses.stop();
+                std::cout << "\t" << name << ": " << duration << "ns";
+                if (branch_misses.available()) {
+                    std::cout << ", " << double(misses) / lookups.size() << " branch misses";
+                }
+                std::cout << std::endl;
+                return found;
+            };
+            std::cout << "Lower bound operation, " << rb_tree.size() << " keys:" << std::endl;
+            auto found = measure("if/else descent",
+                                 [&](int val) { return branchy_lower_bound(rb_tree, val); });
+            EXPECT_EQ(measure("child[bool] descent", [&](int val) { return cmov_lower_bound(rb_tree, val); }),
+                      found);
+            EXPECT_EQ(measure("child[bool] descent, children prefetched",
+                              [&](int val) { return rb_tree.lower_bound(val).node; }),
+                      found);
+        }
+        if (!branch_misses.available()) {
+            std::cout << "\tbranch misses are not counted, perf_event_open: " << branch_misses.error()
+                      << std::endl;
+        }
+    }
+
+    struct HugePageTopDownTraits : HugePageTreeTraits<int>
+    {
+        typedef TopDownRebalance rebalance;
+    };
+
+    template <typename traits>
+    void check_huge_page_nodes()
+    {
+        auto data = datagen::make_random_int_data(5000, 0, 3000);
+        std::set<int> set;
+        RedBlackTree<int, traits> rb_tree;
+        for (auto val: data) {
+            set.insert(val), rb_tree.insert(val);
+        }
+        rbtree_verify(rb_tree);
+        check_container_equality(set, rb_tree);
+
+        // nodes are cut one after another from the first region
+        auto stats = rb_tree.node_storage_stats();
+        EXPECT_EQ(stats.regions, 1u);
+        EXPECT_EQ(stats.reserved_bytes, size_t(2) << 20);
+        auto by_address = [](const int& l, const int& r) { return &l < &r; };
+        auto [low, high] = std::minmax_element(rb_tree.begin(), rb_tree.end(), by_address);
+        EXPECT_LT(size_t((const char*)&*high - (const char*)&*low), rb_tree.size() * 64);
+
+        // erased nodes are reused
+        for (size_t i(0); i < data.size(); i += 2) {
+            set.erase(data[i]), rb_tree.erase(data[i]);
+        }
+        for (int val(0); val < 3000; val += 3) {
+            set.insert(val), rb_tree.insert(val);
+        }
+        rbtree_verify(rb_tree);
+        check_container_equality(set, rb_tree);
+        EXPECT_EQ(rb_tree.node_storage_stats().regions, 1u);
+    }
+
+    TEST(StlRedBlackTree, CheckHugePageNodes) {
+        check_huge_page_nodes<HugePageTreeTraits<int>>();
+        check_huge_page_nodes<HugePageTopDownTraits>();
+        EXPECT_EQ(stl::Set<int>({1, 2}).node_storage_stats().regions, 0u);
+
+        // nodes change arenas by moving their keys, strings check the destructors
+        typedef stl::Set<std::string, HugePageTreeTraits<std::string>> string_set;
+        auto data = datagen::make_random_string_data(2000);
+        auto other_data = datagen::make_random_string_data(2000, 7);
+        string_set set(data.begin(), data.end()), other(other_data.begin(), other_data.end());
+        std::set<std::string> expected(data.begin(), data.end());
+        std::set<std::string> other_expected(other_data.begin(), other_data.end());
+
+        auto key = *set.begin();
+        auto node = set.extract(set.begin());
+        expected.erase(key);
+        node.value() = "~moved";
+        auto result = other.insert(std::move(node));
+        other_expected.insert("~moved");
+        EXPECT_TRUE(result.inserted && result.node.empty() && *result.position == "~moved");
+        node = other.extract(other.begin());
+        other_expected.erase(other_expected.begin());
+        node.reset();
+
+        std::set<std::string> kept;
+        for (auto& val: other_expected) {
+            if (expected.count(val)) {
+                kept.insert(val);
+            }
+        }
+        set.merge(other);
+        expected.insert(other_expected.begin(), other_expected.end());
+        check_container_equality(expected, set);
+        check_container_equality(kept, other);
+
+        // an extracted key leaves the arena: clear drops the regions, and the
+        // handle outlives its tree
+        stl::Set<int, HugePageTreeTraits<int>> ints({1, 2, 3});
+        auto handle = ints.extract(2);
+        ints.clear();
+        EXPECT_EQ(ints.node_storage_stats().regions, 0u);
+        ints.insert(std::move(handle));
+        EXPECT_TRUE(ints.contains(2) && ints.size() == 1);
+        ints.insert(5);
+        EXPECT_TRUE(ints.contains(5) && ints.size() == 2);
+
+        string_set::node_type kept_node, dropped_node;
+        {
+            string_set source({"a", "b", "c"});
+            kept_node = source.extract("b"), dropped_node = source.extract("c");
+        }
+        EXPECT_EQ(kept_node.value(), "b");
+        kept_node.value() = "~kept";
+        EXPECT_TRUE(other.insert(std::move(kept_node)).inserted);
+        dropped_node.reset();
+        EXPECT_TRUE(other.contains("~kept") && other.size() == kept.size() + 1);
+    }
+
+    TEST(StlSet, CompareHugePageLookupTime) {
+        PerfCounter tlb_misses(PerfCounter::Event::DTlbLoadMisses);
+        auto find_time = [&](const auto& set, const std::vector<int>& lookups) {
+            size_t found(0);
+            tlb_misses.start();
+            auto duration = timer([&]() {
+                for (auto val: lookups) {
+                    found += set.contains(val);
+                }
+            }) / lookups.size();
+            auto misses = tlb_misses.stop();
+            std::cout << duration << "ns";
+            if (tlb_misses.available()) {
+                std::cout << ", " << double(misses) / lookups.size() << " dTLB misses";
+            }
+            EXPECT_GT(found, 0u);
+        };
+        for (int nb_values: {1000000, 4000000}) {
+            auto data = datagen::make_random_int_data(nb_values, 0, nb_values * 4);
+            auto lookups = datagen::make_random_int_data(1000000, 0, nb_values * 4, 7);
+            std::cout << "Find operation, " << nb_values << " inserted keys:" << std::endl;
+            {
+                stl::Set<int> set(data.begin(), data.end());
+                std::cout << "\theap nodes: ";
+                find_time(set, lookups);
+                std::cout << std::endl;
+            }
+            stl::Set<int, HugePageTreeTraits<int>> set(data.begin(), data.end());
+            std::cout << "\thuge page nodes: ";
+            find_time(set, lookups);
+            auto stats = set.node_storage_stats();
+            std::cout << " (" << stats.huge_page_regions + stats.explicit_huge_pages << " of "
+                      << stats.regions << " regions on huge pages)" << std::endl;
+        }
+        if (!tlb_misses.available()) {
+            std::cout << "\tdTLB misses are not counted, perf_event_open: " << tlb_misses.error()
+                      << std::endl;
+        }
+    }
+
     TEST(StlSet, CompareTime) {
         int nb_values(1000000);
         auto data = datagen::make_random_int_data(nb_values, 0, nb_values);